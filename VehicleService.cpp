@@ -22,6 +22,7 @@
 
 #include <iostream>
 
+#include <vhal_v2_0/StartupTimeline.h>
 #include <vhal_v2_0/VehicleHalManager.h>
 #include <vhal_v2_0/VisVehicleHal.h>
 #include "EmulatedVehicleHal.h"
@@ -32,6 +33,7 @@ using namespace android::hardware::automotive::vehicle::V2_0;
 using namespace android::hardware::automotive::vehicle::V2_0::xenvm;
 
 int main(int /* argc */, char* /* argv */ []) {
+    StartupTimeline::instance()->mark("service-started");
     auto store = std::make_unique<VehiclePropertyStore>();
     std::unique_ptr<VehicleHal>  hal;
     // Used only for EmulatedVehicleHal
@@ -47,7 +49,11 @@ int main(int /* argc */, char* /* argv */ []) {
         ALOGI("Using EmulatedVehicleHal ...");
     }
 
+    StartupTimeline::instance()->mark("hal-created");
+
+    // VIS is connected, subscribed and fetched in background, the service is registered at once.
     auto service = std::make_unique<VehicleHalManager>(hal.get());
+    StartupTimeline::instance()->mark("hal-initialized");
     configureRpcThreadpool(4, true /* callerWillJoin */);
     ALOGI("Registering as service...");
     status_t status = service->registerAsService();
@@ -57,6 +63,7 @@ int main(int /* argc */, char* /* argv */ []) {
         return 1;
     }
 
+    StartupTimeline::instance()->mark("registered");
     ALOGI("Ready");
     joinRpcThreadpool();
 
@@ -60,6 +60,20 @@ public:
         mCond.notify_one();
     }
 
+    /* Pushes all items under a single lock, thus the consumer receives them in the same batch. */
+    void push(std::vector<T>&& items) {
+        {
+            MuxGuard g(mLock);
+            if (!mIsActive) {
+                return;
+            }
+            for (auto& item : items) {
+                mQueue.push(std::move(item));
+            }
+        }
+        mCond.notify_one();
+    }
+
     /* Deactivates the queue, thus no one can push items to it, also
      * notifies all waiting thread.
      */
@@ -62,6 +62,29 @@ const int32_t kHvacPowerProperties[] = {
     toInt(VehicleProperty::HVAC_FAN_DIRECTION),
 };
 
+/* What to do with a set of a VIS mapped property while VIS is unreachable. */
+enum class OfflineSetPolicy {
+    REPLAY,  // Store the value and write it to VIS on reconnect.
+    REJECT,  // Return TRY_AGAIN.
+};
+
+struct OfflineSetPolicyDeclaration {
+    int32_t prop;
+    OfflineSetPolicy policy;
+};
+
+/**
+ * Offline set policy of writable properties, sets of the properties which are not listed are
+ * replayed.
+ */
+const OfflineSetPolicyDeclaration kOfflineSetPolicies[] = {
+    // Comfort settings are applied whenever VIS is back.
+    {toInt(VehicleProperty::HVAC_TEMPERATURE_SET), OfflineSetPolicy::REPLAY},
+    {toInt(VehicleProperty::HVAC_FAN_SPEED), OfflineSetPolicy::REPLAY},
+    // Shifting gear once VIS is back, possibly much later, may surprise the driver.
+    {toInt(VehicleProperty::GEAR_SELECTION), OfflineSetPolicy::REJECT},
+};
+
 struct ConfigDeclaration {
     VehiclePropConfig config;
 
@@ -17,13 +17,13 @@
 #ifndef android_hardware_automotive_vehicle_V2_0_RecurrentTimer_H_
 #define android_hardware_automotive_vehicle_V2_0_RecurrentTimer_H_
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
-#include <list>
 #include <mutex>
-#include <set>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -31,6 +31,9 @@
 /**
  * This class allows to specify multiple time intervals to receive
  * notifications. A single thread is used internally.
+ *
+ * The thread sleeps on a CLOCK_MONOTONIC timerfd armed with the absolute time of the soonest
+ * event. If timerfd is not available it falls back to a condition variable.
  */
 class RecurrentTimer {
 private:
@@ -40,40 +43,56 @@ private:
 public:
     using Action = std::function<void(const std::vector<int32_t>& cookies)>;
 
-    RecurrentTimer(const Action& action) : mAction(action) {
-        mTimerThread = std::thread(&RecurrentTimer::loop, this, action);
-    }
+    /* Defines what happens with ticks missed because the timer thread woke up too late. */
+    enum class CatchUpPolicy {
+        SKIP,      // Missed ticks are dropped, the next tick is aligned to the interval grid.
+        CATCH_UP,  // Missed ticks are delivered back-to-back, up to kMaxCatchUpTicks.
+    };
 
-    virtual ~RecurrentTimer() {
-        stop();
-    }
+    /* Missed ticks above this backlog are dropped even with CatchUpPolicy::CATCH_UP. */
+    static constexpr int64_t kMaxCatchUpTicks = 4;
+
+    static constexpr size_t kJitterBucketCount = 8;
+
+    /* Per cookie diagnostic counters. Jitter is the delay between scheduled and actual wake-up. */
+    struct EventStats {
+        Nanos interval {0};
+        uint64_t ticks = 0;          // Number of times the cookie was delivered.
+        uint64_t missedTicks = 0;    // Ticks which were not delivered in time.
+        uint64_t droppedTicks = 0;   // Missed ticks discarded by the catch-up policy.
+        uint64_t caughtUpTicks = 0;  // Missed ticks delivered late by the catch-up policy.
+        Nanos maxJitter {0};
+        Nanos totalJitter {0};
+        std::array<uint64_t, kJitterBucketCount> jitterHistogram {};
+    };
+
+    /**
+     * @param timerSlack - if non-zero, it is applied to the timer thread with PR_SET_TIMERSLACK,
+     *                     so the kernel can coalesce our wake-ups with other timers.
+     * @param policy - how the ticks missed by a late wake-up are handled.
+     */
+    RecurrentTimer(const Action& action, Nanos timerSlack = Nanos(0),
+                   CatchUpPolicy policy = CatchUpPolicy::SKIP);
+
+    virtual ~RecurrentTimer();
 
     /**
      * Registers recurrent event for a given interval. Registred events are distinguished by
      * cookies thus calling this method multiple times with the same cookie will override the
      * interval provided before.
      */
-    void registerRecurrentEvent(std::chrono::nanoseconds interval, int32_t cookie) {
-        TimePoint now = Clock::now();
-        // Align event time point among all intervals. Thus if we have two intervals 1ms and 2ms,
-        // during every second wake-up both intervals will be triggered.
-        TimePoint absoluteTime = now - Nanos(now.time_since_epoch().count() % interval.count());
-
-        {
-            std::lock_guard<std::mutex> g(mLock);
-            mCookieToEventsMap[cookie] = { interval, cookie, absoluteTime };
-        }
-        mCond.notify_one();
-    }
+    void registerRecurrentEvent(std::chrono::nanoseconds interval, int32_t cookie);
+
+    void unregisterRecurrentEvent(int32_t cookie);
 
-    void unregisterRecurrentEvent(int32_t cookie) {
-        {
-            std::lock_guard<std::mutex> g(mLock);
-            mCookieToEventsMap.erase(cookie);
-        }
-        mCond.notify_one();
+    bool usesTimerFd() const {
+        return mTimerFd >= 0;
     }
 
+    std::unordered_map<int32_t, EventStats> getStats() const;
+
+    /* Returns human readable statistics of all registered events, used for debug dumps. */
+    std::string dumpStats() const;
 
 private:
 
@@ -81,68 +100,27 @@ private:
         Nanos interval;
         int32_t cookie;
         TimePoint absoluteTime;  // Absolute time of the next event.
+        EventStats stats;
 
-        void updateNextEventTime(TimePoint now) {
-            // We want to move time to next event by adding some number of intervals (usually 1)
-            // to previous absoluteTime.
-            int intervalMultiplier = (now - absoluteTime) / interval;
-            if (intervalMultiplier <= 0) intervalMultiplier = 1;
-            absoluteTime += intervalMultiplier * interval;
-        }
+        /* Accounts the tick that is due at absoluteTime and moves it to the next event. */
+        void onTick(TimePoint now, CatchUpPolicy policy);
     };
 
-    void loop(const Action& action) {
-        static constexpr auto kInvalidTime = TimePoint(Nanos::max());
-
-        std::vector<int32_t> cookies;
-
-        while (!mStopRequested) {
-            auto now = Clock::now();
-            auto nextEventTime = kInvalidTime;
-            cookies.clear();
-
-            {
-                std::unique_lock<std::mutex> g(mLock);
-
-                for (auto&& it : mCookieToEventsMap) {
-                    RecurrentEvent& event = it.second;
-                    if (event.absoluteTime <= now) {
-                        event.updateNextEventTime(now);
-                        cookies.push_back(event.cookie);
-                    }
-
-                    if (nextEventTime > event.absoluteTime) {
-                        nextEventTime = event.absoluteTime;
-                    }
-                }
-            }
-
-            if (cookies.size() != 0) {
-                action(cookies);
-            }
-
-            std::unique_lock<std::mutex> g(mLock);
-            mCond.wait_until(g, nextEventTime);  // nextEventTime can be nanoseconds::max()
-        }
-    }
-
-    void stop() {
-        mStopRequested = true;
-        {
-            std::lock_guard<std::mutex> g(mLock);
-            mCookieToEventsMap.clear();
-        }
-        mCond.notify_one();
-        if (mTimerThread.joinable()) {
-            mTimerThread.join();
-        }
-    }
+    void loop(const Action& action);
+    void waitOnTimerFd(TimePoint nextEventTime, bool disarm);
+    void wakeUp();
+    void closeFds();
+    void stop();
 private:
     mutable std::mutex mLock;
     std::thread mTimerThread;
     std::condition_variable mCond;
     std::atomic_bool mStopRequested { false };
     Action mAction;
+    const Nanos mTimerSlack;
+    const CatchUpPolicy mCatchUpPolicy;
+    int mTimerFd = -1;
+    int mWakeUpFd = -1;
     std::unordered_map<int32_t, RecurrentEvent> mCookieToEventsMap;
 };
 
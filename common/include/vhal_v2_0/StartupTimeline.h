@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMMON_INCLUDE_VHAL_V2_0_STARTUPTIMELINE_H_
+#define COMMON_INCLUDE_VHAL_V2_0_STARTUPTIMELINE_H_
+
+#include <log/log.h>
+#include <utils/SystemClock.h>
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+
+/*
+ * Boot time of every service start-up phase. Only the first occurrence of a phase is recorded,
+ * e.g. the first connection to VIS, the phases are logged and returned by debug dumps.
+ */
+class StartupTimeline {
+public:
+    static StartupTimeline* instance() {
+        static StartupTimeline inst;
+        return &inst;
+    }
+
+    /* Records the phase, name must be a string literal. */
+    void mark(const char* phase) {
+        int64_t now = elapsedRealtimeNano();
+        std::lock_guard<std::mutex> g(mLock);
+        for (const auto& it : mPhases) {
+            if (strcmp(it.first, phase) == 0) {
+                return;
+            }
+        }
+        int64_t sinceStartMs = mPhases.empty() ? 0 : (now - mPhases.front().second) / 1000000;
+        ALOGI("Startup phase %s: +%lld ms", phase, static_cast<long long>(sinceStartMs));
+        mPhases.emplace_back(phase, now);
+    }
+
+    std::string dump() const {
+        std::lock_guard<std::mutex> g(mLock);
+        std::string out = "Startup timeline (ms since " +
+                          (mPhases.empty() ? std::string("start") : mPhases.front().first) +
+                          "):";
+        for (const auto& it : mPhases) {
+            out += std::string(" ") + it.first + ":" +
+                   std::to_string((it.second - mPhases.front().second) / 1000000);
+        }
+        out += "\n";
+        return out;
+    }
+
+private:
+    StartupTimeline() = default;
+
+    mutable std::mutex mLock;
+    std::vector<std::pair<const char*, int64_t>> mPhases;
+};
+
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif /* COMMON_INCLUDE_VHAL_V2_0_STARTUPTIMELINE_H_ */
@@ -36,6 +36,7 @@ public:
     using VehiclePropValuePtr = recyclable_ptr<VehiclePropValue>;
 
     using HalEventFunction = std::function<void(VehiclePropValuePtr)>;
+    using HalEventBatchFunction = std::function<void(std::vector<VehiclePropValuePtr>)>;
     using HalErrorFunction = std::function<void(
             StatusCode errorCode, int32_t property, int32_t areaId)>;
 
@@ -71,13 +72,21 @@ public:
      */
     virtual void onCreate() {}
 
+    /**
+     * Override this method to provide implementation specific diagnostic information. It is
+     * returned to the clients of IVehicle::debugDump.
+     */
+    virtual std::string dump() { return std::string(); }
+
     void init(
         VehiclePropValuePool* valueObjectPool,
         const HalEventFunction& onHalEvent,
-        const HalErrorFunction& onHalError) {
+        const HalErrorFunction& onHalError,
+        const HalEventBatchFunction& onHalEvents = nullptr) {
         mValuePool = valueObjectPool;
         mOnHalEvent = onHalEvent;
         mOnHalPropertySetError = onHalError;
+        mOnHalEvents = onHalEvents;
 
         onCreate();
     }
@@ -91,6 +100,17 @@ protected:
         mOnHalEvent(std::move(v));
     }
 
+    /* Propagates several property change events at once, they are delivered in the same batch. */
+    void doHalEvents(std::vector<VehiclePropValuePtr> values) {
+        if (mOnHalEvents) {
+            mOnHalEvents(std::move(values));
+            return;
+        }
+        for (auto& v : values) {
+            mOnHalEvent(std::move(v));
+        }
+    }
+
     /* Propagates error during set operation to the vehicle HAL clients. */
     void doHalPropertySetError(StatusCode errorCode,
                                int32_t propId,
@@ -100,6 +120,7 @@ protected:
 
 private:
     HalEventFunction mOnHalEvent;
+    HalEventBatchFunction mOnHalEvents;
     HalErrorFunction mOnHalPropertySetError;
     VehiclePropValuePool* mValuePool;
 };
@@ -81,6 +81,7 @@ private:
     // ---------------------------------------------------------------------------------------------
     // Events received from VehicleHal
     void onHalEvent(VehiclePropValuePtr  v);
+    void onHalEvents(std::vector<VehiclePropValuePtr> values);
     void onHalPropertySetError(StatusCode errorCode, int32_t property,
                                int32_t areaId);
 
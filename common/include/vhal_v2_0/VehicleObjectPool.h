@@ -18,9 +18,16 @@
 #ifndef android_hardware_automotive_vehicle_V2_0_VehicleObjectPool_H_
 #define android_hardware_automotive_vehicle_V2_0_VehicleObjectPool_H_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <deque>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <android/hardware/automotive/vehicle/2.0/types.h>
 
@@ -30,33 +37,26 @@ namespace automotive {
 namespace vehicle {
 namespace V2_0 {
 
-// Handy metric mostly for unit tests and debug.
-#define INC_METRIC_IF_DEBUG(val) PoolStats::instance()->val++;
-struct PoolStats {
-    std::atomic<uint32_t> Obtained {0};
-    std::atomic<uint32_t> Created {0};
-    std::atomic<uint32_t> Recycled {0};
-
-    static PoolStats* instance() {
-        static PoolStats inst;
-        return &inst;
-    }
-};
+template<typename T>
+class ObjectPool;
 
+/**
+ * Deleter that returns the object to the pool it was obtained from. Objects
+ * which are not owned by any pool are deleted.
+ *
+ * It holds only a pointer to the pool, thus recyclable_ptr<> is as small as
+ * a pair of raw pointers.
+ */
 template<typename T>
 struct Deleter  {
-    using OnDeleteFunc = std::function<void(T*)>;
-
-    Deleter(const OnDeleteFunc& f) : mOnDelete(f) {};
+    explicit Deleter(ObjectPool<T>* pool) : mPool(pool) {};
 
     Deleter() = default;
     Deleter(const Deleter&) = default;
 
-    void operator()(T* o) {
-        mOnDelete(o);
-    }
+    void operator()(T* o) const;
 private:
-    OnDeleteFunc mOnDelete;
+    ObjectPool<T>* mPool = nullptr;
 };
 
 /**
@@ -74,59 +74,336 @@ using recyclable_ptr = typename std::unique_ptr<T, Deleter<T>>;
  * multiple threads is OK, also client can obtain an object in one thread and
  * then move ownership to another thread.
  *
+ * Free objects are cached per thread in magazines (fixed size stacks of objects), so obtain and
+ * recycle do not take any lock in the common case. When a thread runs out of objects or has
+ * no room for recycled ones, it exchanges a whole magazine with the depot shared by all threads.
+ * Thus objects obtained in one thread and recycled in another are balanced between threads with
+ * a single lock per kMagazineSize objects.
+ *
+ * If maxMagazines is not zero, free objects are limited to this number of magazines. Objects
+ * cached by threads count against the limit too: a full magazine is released to the heap instead
+ * of being stored in the depot if the free objects of the depot and of all threads, including
+ * the empty magazine given back in exchange, would exceed it.
+ *
+ * Pools can be filled in advance with #prewarm(...) and shrunk after a burst with #trim(...).
  */
 template<typename T>
 class ObjectPool {
 public:
-    ObjectPool() = default;
-    virtual ~ObjectPool() = default;
+    explicit ObjectPool(size_t maxMagazines = 0)
+        : mDepot(std::make_shared<Depot>(maxMagazines * kMagazineSize)),
+          mDeleter(this) {}
+
+    virtual ~ObjectPool() {
+        mDepot->closed = true;
+    }
 
     virtual recyclable_ptr<T> obtain() {
-        std::lock_guard<std::mutex> g(mLock);
-        INC_METRIC_IF_DEBUG(Obtained)
-        if (mObjects.empty()) {
-            INC_METRIC_IF_DEBUG(Created)
+        ThreadCache& cache = getThreadCache();
+        cache.count(&cache.obtained);
+        T* o = cache.pop();
+        if (o == nullptr) {
+            cache.count(&cache.created);
             return wrap(createObject());
         }
+        return wrap(o);
+    }
+
+    struct Stats {
+        uint64_t obtained = 0;
+        uint64_t created = 0;  // Obtained objects which were not found in the pool.
+        uint64_t recycled = 0;
+        uint64_t released = 0;  // Free objects given back to the heap.
+        size_t depotObjects = 0;
+    };
 
-        auto o = wrap(mObjects.front().release());
-        mObjects.pop_front();
+    Stats getStats() const {
+        std::lock_guard<std::mutex> g(mDepot->lock);
+        Stats stats = mDepot->stats;
+        for (const ThreadCache* cache : mDepot->caches) {
+            stats.obtained += cache->obtained.load(std::memory_order_relaxed);
+            stats.created += cache->created.load(std::memory_order_relaxed);
+            stats.recycled += cache->recycled.load(std::memory_order_relaxed);
+        }
+        stats.depotObjects = mDepot->countObjects();
+        return stats;
+    }
 
-        return o;
+    /**
+     * Creates count free objects in advance. Objects kept due to pre-warming are not released by
+     * #trim(...). Exactly count objects are created, a magazine left partially filled by the
+     * previous call is topped up first.
+     */
+    void prewarm(size_t count) {
+        while (count > 0) {
+            auto m = std::make_unique<Magazine>();
+            for (; count > 0 && !m->full(); count--) {
+                m->push(createObject());
+            }
+            std::lock_guard<std::mutex> g(mDepot->lock);
+            if (!mDepot->full.empty() && !mDepot->full.back()->full()) {
+                Magazine* partial = mDepot->full.back().get();
+                while (!partial->full() && !m->empty()) {
+                    partial->push(m->pop());
+                    mDepot->prewarmed++;
+                }
+                if (m->empty()) {
+                    continue;
+                }
+            }
+            if (!mDepot->hasRoomFor(m->count)) {
+                m->clear();
+                break;
+            }
+            mDepot->prewarmed += m->count;
+            mDepot->full.push_back(std::move(m));
+        }
+    }
+
+    /**
+     * Releases free objects stored in the depot above highWaterMark (or above the number of
+     * pre-warmed objects, whichever is greater). Objects cached by threads are not affected.
+     * Returns number of released objects.
+     */
+    size_t trim(size_t highWaterMark) {
+        std::vector<MagazinePtr> released;
+        size_t releasedCount = 0;
+        {
+            std::lock_guard<std::mutex> g(mDepot->lock);
+            size_t keep = std::max(highWaterMark, mDepot->prewarmed);
+            size_t objects = mDepot->countObjects();
+            while (objects > keep && objects - mDepot->full.back()->count >= keep) {
+                objects -= mDepot->full.back()->count;
+                releasedCount += mDepot->full.back()->count;
+                released.push_back(std::move(mDepot->full.back()));
+                mDepot->full.pop_back();
+            }
+            // There is no need in more empty magazines than the full ones.
+            mDepot->empty.resize(std::min(mDepot->empty.size(), mDepot->full.size()));
+            mDepot->stats.released += releasedCount;
+        }
+        for (auto& m : released) {
+            m->clear();
+        }
+        return releasedCount;
     }
 
     ObjectPool& operator =(const ObjectPool &) = delete;
     ObjectPool(const ObjectPool &) = delete;
 
 protected:
+    friend struct Deleter<T>;
+
     virtual T* createObject() = 0;
 
     virtual void recycle(T* o) {
-        INC_METRIC_IF_DEBUG(Recycled)
-        std::lock_guard<std::mutex> g(mLock);
-        mObjects.push_back(std::unique_ptr<T> { o } );
+        ThreadCache& cache = getThreadCache();
+        cache.count(&cache.recycled);
+        cache.push(o);
     }
 
 private:
-    const Deleter<T>& getDeleter() {
-        if (!mDeleter.get()) {
-            Deleter<T> *d = new Deleter<T>(std::bind(
-                &ObjectPool::recycle, this, std::placeholders::_1));
-            mDeleter.reset(d);
+    static constexpr size_t kMagazineSize = 16;
+
+    struct Magazine {
+        size_t count = 0;
+        std::array<T*, kMagazineSize> objects;
+
+        bool empty() const { return count == 0; }
+        bool full() const { return count == kMagazineSize; }
+        T* pop() { return objects[--count]; }
+        void push(T* o) { objects[count++] = o; }
+        void clear() {
+            while (!empty()) {
+                delete pop();
+            }
+        }
+    };
+    using MagazinePtr = std::unique_ptr<Magazine>;
+
+    struct ThreadCache;
+
+    /* Magazines shared by all threads. It outlives the pool while threads still cache objects. */
+    struct Depot {
+        std::mutex lock;
+        std::vector<MagazinePtr> full;
+        std::vector<MagazinePtr> empty;
+        std::atomic<bool> closed {false};
+        const size_t maxObjects;
+        size_t prewarmed = 0;
+        /* Live thread caches and counters of the exited ones. */
+        std::vector<const ThreadCache*> caches;
+        Stats stats;
+
+        Depot(size_t maxFreeObjects) : maxObjects(maxFreeObjects) {}
+
+        ~Depot() {
+            for (auto& m : full) {
+                m->clear();
+            }
+        }
+
+        /* Number of objects in the stored magazines, called under the lock. Magazines filled by
+         * #prewarm(...) may be partially filled. */
+        size_t countObjects() const {
+            size_t objects = 0;
+            for (const auto& m : full) {
+                objects += m->count;
+            }
+            return objects;
+        }
+
+        /* Whether count more free objects fit into maxObjects together with the objects of the
+         * depot and of the live thread caches, called under the lock. */
+        bool hasRoomFor(size_t count) const {
+            if (maxObjects == 0) {
+                return true;
+            }
+            size_t objects = countObjects() + count;
+            for (const ThreadCache* cache : caches) {
+                objects += cache->objects.load(std::memory_order_relaxed);
+            }
+            return objects <= maxObjects;
+        }
+
+        /* Replaces given empty magazine with a non-empty one, returns false if there is none. */
+        bool exchangeForFull(MagazinePtr* m) {
+            std::lock_guard<std::mutex> g(lock);
+            if (full.empty()) {
+                return false;
+            }
+            empty.push_back(std::move(*m));
+            *m = std::move(full.back());
+            full.pop_back();
+            return true;
+        }
+
+        /* Replaces given full magazine with an empty one. */
+        void exchangeForEmpty(MagazinePtr* m) {
+            {
+                std::lock_guard<std::mutex> g(lock);
+                // The magazine is still counted by its thread cache, which gets an empty one
+                // back to fill.
+                if (hasRoomFor(kMagazineSize)) {
+                    full.push_back(std::move(*m));
+                    if (empty.empty()) {
+                        *m = std::make_unique<Magazine>();
+                    } else {
+                        *m = std::move(empty.back());
+                        empty.pop_back();
+                    }
+                    return;
+                }
+                stats.released += (*m)->count;
+            }
+            // The depot is at its capacity, give the objects back to the heap.
+            (*m)->clear();
+        }
+    };
+
+    /* Objects of a single pool cached by a single thread: the loaded magazine and the previously
+     * loaded one, which allows to alternate obtain and recycle on a magazine boundary without
+     * going to the depot. */
+    struct ThreadCache {
+        std::shared_ptr<Depot> depot;
+        MagazinePtr loaded = std::make_unique<Magazine>();
+        MagazinePtr previous = std::make_unique<Magazine>();
+        /* Written only by the owning thread, read by #getStats(). */
+        std::atomic<uint64_t> obtained {0};
+        std::atomic<uint64_t> created {0};
+        std::atomic<uint64_t> recycled {0};
+        /* Number of objects in both magazines, written only by the owning thread. */
+        std::atomic<size_t> objects {0};
+
+        ThreadCache(const std::shared_ptr<Depot>& d) : depot(d) {
+            std::lock_guard<std::mutex> g(depot->lock);
+            depot->caches.push_back(this);
         }
-        return *mDeleter.get();
+
+        ~ThreadCache() {
+            std::lock_guard<std::mutex> g(depot->lock);
+            depot->caches.erase(std::find(depot->caches.begin(), depot->caches.end(), this));
+            // Give the cached objects to other threads on thread exit.
+            for (MagazinePtr* m : {&loaded, &previous}) {
+                if (depot->closed || (*m)->empty()) {
+                    (*m)->clear();
+                } else if (depot->hasRoomFor((*m)->count)) {
+                    depot->full.push_back(std::move(*m));
+                } else {
+                    depot->stats.released += (*m)->count;
+                    (*m)->clear();
+                }
+            }
+            depot->stats.obtained += obtained;
+            depot->stats.created += created;
+            depot->stats.recycled += recycled;
+        }
+
+        /* No need in atomic increment, there is a single writer. */
+        static void count(std::atomic<uint64_t>* counter) {
+            counter->store(counter->load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+        }
+
+        T* pop() {
+            if (loaded->empty()) {
+                if (previous->empty() && !depot->exchangeForFull(&previous)) {
+                    return nullptr;
+                }
+                std::swap(loaded, previous);
+            }
+            T* o = loaded->pop();
+            updateObjects();
+            return o;
+        }
+
+        void push(T* o) {
+            if (loaded->full()) {
+                if (previous->full()) {
+                    depot->exchangeForEmpty(&previous);
+                }
+                std::swap(loaded, previous);
+            }
+            loaded->push(o);
+            updateObjects();
+        }
+
+        void updateObjects() {
+            objects.store(loaded->count + previous->count, std::memory_order_relaxed);
+        }
+    };
+
+    ThreadCache& getThreadCache() {
+        static thread_local std::unordered_map<Depot*, std::unique_ptr<ThreadCache>> caches;
+        auto it = caches.find(mDepot.get());
+        if (it == caches.end()) {
+            // Release caches of destroyed pools before adding a new one.
+            for (auto cacheIt = caches.begin(); cacheIt != caches.end();) {
+                cacheIt = cacheIt->first->closed ? caches.erase(cacheIt) : std::next(cacheIt);
+            }
+            it = caches.emplace(mDepot.get(), std::make_unique<ThreadCache>(mDepot)).first;
+        }
+        return *it->second;
     }
 
     recyclable_ptr<T> wrap(T* raw) {
-        return recyclable_ptr<T> { raw, getDeleter() };
+        return recyclable_ptr<T> { raw, mDeleter };
     }
 
 private:
-    mutable std::mutex mLock;
-    std::deque<std::unique_ptr<T>> mObjects;
-    std::unique_ptr<Deleter<T>> mDeleter;
+    std::shared_ptr<Depot> mDepot;
+    const Deleter<T> mDeleter;
 };
 
+template<typename T>
+void Deleter<T>::operator()(T* o) const {
+    if (mPool != nullptr) {
+        mPool->recycle(o);
+    } else {
+        delete o;
+    }
+}
+
 /**
  * This class provides a pool of recycable VehiclePropertyValue objects.
  *
@@ -138,11 +415,18 @@ private:
  * safely pass it around. Once this object goes out of scope, it will be
  * returned the the object pool.
  *
- * Some objects are not recycable: strings and vector data types with
- * vector length > maxRecyclableVectorSize (provided in the constructor). These
- * objects will be deleted immediately once the go out of scope. There's no
- * synchornization penalty for these objects since we do not store them in the
- * pool.
+ * Vector data types with vector length <= maxRecyclableVectorSize (provided
+ * in the constructor) are stored in pools of exactly that type and length.
+ * Longer vectors up to kMaxBoundedVectorSize are stored in pools of exactly
+ * their length as well, since hidl_vec has no spare capacity and a value of
+ * another length would be reallocated anyway. Strings and mixed values are
+ * stored in a single pool per type. These bounded pools keep at most
+ * kBoundedPoolMaxMagazines magazines of free objects, and values with vectors
+ * longer than kMaxBoundedVectorSize are not recycable at all. These objects
+ * will be deleted immediately once the go out of scope.
+ *
+ * Values of STRING type obtained from the pool may hold the string of the
+ * previous user, thus callers must always set stringValue.
  *
  * This class is thread-safe. Users can obtain an object in one thread and pass
  * it to another.
@@ -162,19 +446,30 @@ class VehiclePropValuePool {
 public:
     using RecyclableType = recyclable_ptr<VehiclePropValue>;
 
+    /* Values with longer vectors are allocated and deleted on every use. */
+    static constexpr size_t kMaxBoundedVectorSize = 256;
+    /* Free objects a bounded pool keeps, including the ones cached by threads. */
+    static constexpr size_t kBoundedPoolMaxMagazines = 4;
+    /* Number of value types. */
+    static constexpr size_t kPoolTypeCount = 10;
+
     /**
      * Creates VehiclePropValuePool
      *
      * @param maxRecyclableVectorSize - vector value types (e.g.
      * VehiclePropertyType::INT32_VEC) with size equal or less to this value
-     * will be stored in the pool. If users tries to obtain value with vector
-     * size greater than maxRecyclableVectorSize user will receive appropriate
-     * object, but once it goes out of scope it will be deleted immediately, not
-     * returning back to the object pool.
+     * will be stored in the pool of exactly this vector size. If users tries to
+     * obtain value with vector size greater than maxRecyclableVectorSize user
+     * will receive appropriate object from a bounded pool.
      *
      */
     VehiclePropValuePool(size_t maxRecyclableVectorSize = 4) :
-        mMaxRecyclableVectorSize(maxRecyclableVectorSize) {};
+        mMaxRecyclableVectorSize(maxRecyclableVectorSize),
+        mMaxPooledVectorSize(std::max(maxRecyclableVectorSize, kMaxBoundedVectorSize)),
+        mRecyclablePoolTable(
+            new std::atomic<InternalPool*>[kPoolTypeCount * (mMaxPooledVectorSize + 1)]()),
+        mStringPool(VehiclePropertyType::STRING),
+        mMixedPool(VehiclePropertyType::MIXED) {};
 
     RecyclableType obtain(VehiclePropertyType type);
 
@@ -187,27 +482,55 @@ public:
     RecyclableType obtainString(const char* cstr);
     RecyclableType obtainComplex();
 
+    /**
+     * Allocates values for given property in advance, so the first events after boot do not
+     * hit the heap. It is called once per property: continuous properties get a value per area,
+     * as all areas are sampled at once, other properties get a single value. Vector size is taken
+     * from initialValue.
+     */
+    void prewarm(const VehiclePropConfig& config, const VehiclePropValue::RawValue& initialValue);
+
+    /**
+     * Releases free values above highWaterMark (but not the pre-warmed ones) in every pool.
+     * Returns number of released values.
+     */
+    size_t trim(size_t highWaterMark);
+
+    /* Returns human readable hit/miss statistics of every pool. */
+    std::string dump() const;
+
     VehiclePropValuePool(VehiclePropValuePool& ) = delete;
     VehiclePropValuePool& operator=(VehiclePropValuePool&) = delete;
 private:
     bool isDisposable(VehiclePropertyType type, size_t vecSize) const {
-        return vecSize > mMaxRecyclableVectorSize || VehiclePropertyType::STRING == type ||
-               VehiclePropertyType::MIXED == type;
+        return vecSize > mMaxPooledVectorSize && VehiclePropertyType::STRING != type &&
+               VehiclePropertyType::MIXED != type;
     }
 
     RecyclableType obtainDisposable(VehiclePropertyType valueType,
                                     size_t vectorSize) const;
     RecyclableType obtainRecylable(VehiclePropertyType type,
                                    size_t vecSize);
+    ObjectPool<VehiclePropValue>* getPool(VehiclePropertyType type, size_t vecSize);
+
+    class InternalPool;
+    class VariablePool;
+    InternalPool* getRecyclablePool(VehiclePropertyType type, size_t vecSize);
+    static size_t getTypeIndex(VehiclePropertyType type);
 
     class InternalPool: public ObjectPool<VehiclePropValue> {
     public:
-        InternalPool(VehiclePropertyType type, size_t vectorSize)
-            : mPropType(type), mVectorSize(vectorSize) {}
+        InternalPool(VehiclePropertyType type, size_t vectorSize, size_t maxMagazines = 0)
+            : ObjectPool<VehiclePropValue>(maxMagazines),
+              mPropType(type), mVectorSize(vectorSize), mBounded(maxMagazines != 0) {}
 
         RecyclableType obtain() {
             return ObjectPool<VehiclePropValue>::obtain();
         }
+
+        VehiclePropertyType getType() const { return mPropType; }
+        size_t getVectorSize() const { return mVectorSize; }
+        bool isBounded() const { return mBounded; }
     protected:
         VehiclePropValue* createObject() override;
         void recycle(VehiclePropValue* o) override;
@@ -221,19 +544,40 @@ private:
     private:
         VehiclePropertyType mPropType;
         size_t mVectorSize;
+        bool mBounded;
     };
 
-private:
-    const Deleter<VehiclePropValue> mDisposableDeleter {
-        [] (VehiclePropValue* v) {
-            delete v;
+    /* Pool of STRING or MIXED values, which are recycled whatever length their contents have. */
+    class VariablePool: public ObjectPool<VehiclePropValue> {
+    public:
+        VariablePool(VehiclePropertyType type)
+            : ObjectPool<VehiclePropValue>(kBoundedPoolMaxMagazines), mPropType(type) {}
+
+        RecyclableType obtain() {
+            return ObjectPool<VehiclePropValue>::obtain();
         }
+
+        VehiclePropertyType getType() const { return mPropType; }
+    protected:
+        VehiclePropValue* createObject() override;
+        void recycle(VehiclePropValue* o) override;
+    private:
+        bool check(VehiclePropValue::RawValue* v);
+    private:
+        VehiclePropertyType mPropType;
     };
 
 private:
     mutable std::mutex mLock;
     const size_t mMaxRecyclableVectorSize;
+    const size_t mMaxPooledVectorSize;
+    /* Pools are owned by the map, guarded by mLock. */
     std::map<int32_t, std::unique_ptr<InternalPool>> mValueTypePools;
+    /* Lock-free lookup table indexed by value type and vector size. A pool is published in the
+     * table once it is added to the map and never removed. */
+    std::unique_ptr<std::atomic<InternalPool*>[]> mRecyclablePoolTable;
+    VariablePool mStringPool;
+    VariablePool mMixedPool;
 };
 
 }  // namespace V2_0
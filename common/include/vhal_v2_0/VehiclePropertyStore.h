@@ -24,6 +24,8 @@
 
 #include <android/hardware/automotive/vehicle/2.0/IVehicle.h>
 
+#include "VehicleObjectPool.h"
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -43,6 +45,8 @@ class VehiclePropertyStore {
 public:
     /* Function that used to calculate unique token for given VehiclePropValue */
     using TokenFunction = std::function<int64_t(const VehiclePropValue& value)>;
+    /* Function that changes value in place, returns true if the value has been changed */
+    using ValueMutator = std::function<bool(VehiclePropValue* value)>;
 
 public:
     struct RecordConfig {
@@ -69,11 +73,24 @@ public:
      * example wasn't registered. */
     bool writeValue(const VehiclePropValue& propValue, bool updateStatus);
 
+    /* Changes stored value in place under a single lock without copying it. If mutator reports
+     * a change, the value gets provided timestamp and, if pool is given, event is set to a pooled
+     * copy of the updated value. Returns true if the value has been changed. */
+    bool updateValue(int32_t prop, int32_t area, int64_t timestamp, const ValueMutator& mutator,
+                     VehiclePropValuePool* pool = nullptr,
+                     recyclable_ptr<VehiclePropValue>* event = nullptr);
+
     void removeValue(const VehiclePropValue& propValue);
     void removeValuesForProperty(int32_t propId);
 
     std::vector<VehiclePropValue> readAllValues() const;
     std::vector<VehiclePropValue> readValuesForProperty(int32_t propId) const;
+
+    /* Calls visitor for values of all areas of every given property with the given change mode.
+     * Values are visited in one pass under a single lock, thus visitor must not call the store. */
+    void readValuesForProperties(const std::vector<int32_t>& propIds,
+                                 VehiclePropertyChangeMode changeMode,
+                                 const std::function<void(const VehiclePropValue&)>& visitor) const;
     std::unique_ptr<VehiclePropValue> readValueOrNull(const VehiclePropValue& request) const;
     std::unique_ptr<VehiclePropValue> readValueOrNull(int32_t prop, int32_t area = 0,
                                                       int64_t token = 0) const;
@@ -18,6 +18,7 @@
 #define android_hardware_automotive_vehicle_V2_0_VehicleUtils_H_
 
 #include <memory>
+#include <string>
 
 #include <hidl/HidlSupport.h>
 
@@ -76,6 +77,15 @@ void shallowCopyHidlStr(hidl_string* dest, const hidl_string& src);
 
 void shallowCopy(VehiclePropValue* dest, const VehiclePropValue& src);
 
+/**
+ * Value of a path property which disables the feature using the path. An empty value can't
+ * disable it, property_get() returns the default value for it.
+ */
+constexpr char kDisabledPath[] = "none";
+
+/** Returns the path read from a property, or an empty string if it is kDisabledPath. */
+std::string toOptionalPath(const char* value);
+
 }  // namespace V2_0
 }  // namespace vehicle
 }  // namespace automotive
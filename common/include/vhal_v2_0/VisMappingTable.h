@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMMON_INCLUDE_VHAL_V2_0_VISMAPPINGTABLE_H_
+#define COMMON_INCLUDE_VHAL_V2_0_VISMAPPINGTABLE_H_
+
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+/*
+ * Precompiled vehicle property to VIS mappings, memory mapped on load.
+ *
+ * The table is compiled from the static mappings overridden by the JSON mapping file on the
+ * first start. It is used instead of both as long as size and modification time of the JSON
+ * file and the hash of the static mappings are the same. VIS names are stored in the id order
+ * of VisNameIndex with the seeds of its perfect hash, so the index is not rebuilt on load.
+ * Layout (native endian):
+ *   Header
+ *   Entry[entryCount]            - property, area and id of the VIS name, ordered by the id
+ *   uint32_t[nameCount]          - seeds of the perfect hash
+ *   uint32_t[nameCount + 1]      - offsets of the names in the string blob
+ *   char[stringsSize]            - VIS names in id order, not zero terminated
+ */
+class VisMappingTable {
+public:
+    struct Mapping {
+        int32_t prop;
+        int32_t area;
+        uint32_t nameId;
+    };
+
+    VisMappingTable() = default;
+    ~VisMappingTable();
+
+    VisMappingTable(const VisMappingTable&) = delete;
+    VisMappingTable& operator=(const VisMappingTable&) = delete;
+
+    /* Maps the table, returns false if it is missing, invalid or compiled from other mappings. */
+    bool load(const std::string& path, const struct stat& source, uint64_t staticHash);
+
+    /* Writes the mappings, ordered by the name id, and the VIS names with their seeds. */
+    static bool compile(const std::vector<Mapping>& mappings,
+                        const std::vector<std::string>& names, const std::vector<uint32_t>& seeds,
+                        const struct stat& source, uint64_t staticHash, const std::string& path);
+
+    size_t size() const { return mHeader != nullptr ? mHeader->entryCount : 0; }
+    int32_t getProperty(size_t i) const { return mEntries[i].prop; }
+    int32_t getArea(size_t i) const { return mEntries[i].area; }
+    uint32_t getNameId(size_t i) const { return mEntries[i].nameId; }
+
+    size_t getNameCount() const { return mHeader != nullptr ? mHeader->nameCount : 0; }
+    uint32_t getSeed(uint32_t id) const { return mSeeds[id]; }
+    std::string getVisName(uint32_t id) const {
+        return std::string(mStrings + mNameOffsets[id], mNameOffsets[id + 1] - mNameOffsets[id]);
+    }
+
+private:
+    static constexpr uint32_t kMagic = 0x544d4856;  // "VHMT"
+    static constexpr uint32_t kVersion = 2;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceMtimeNs;
+        uint64_t staticHash;
+        uint32_t entryCount;
+        uint32_t nameCount;
+        uint32_t stringsSize;
+        uint32_t reserved;
+    };
+
+    using Entry = Mapping;
+
+    static int64_t getMtimeNs(const struct stat& st) {
+        return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    void* mData = nullptr;
+    size_t mDataSize = 0;
+    const Header* mHeader = nullptr;
+    const Entry* mEntries = nullptr;
+    const uint32_t* mSeeds = nullptr;
+    const uint32_t* mNameOffsets = nullptr;
+    const char* mStrings = nullptr;
+};
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif /* COMMON_INCLUDE_VHAL_V2_0_VISMAPPINGTABLE_H_ */
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2018 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMMON_INCLUDE_VHAL_V2_0_VISNAMEINDEX_H_
+#define COMMON_INCLUDE_VHAL_V2_0_VISNAMEINDEX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+/*
+ * This is thread-safe immutable index of VIS property names.
+ *
+ * Every mapped VIS name is interned into a dense id in [0, size()) and all values mapped to the
+ * name are stored contiguously. Names are looked up with a minimal perfect hash built over the
+ * mapping set (hash and displace): the first hash selects a bucket, the seed stored for the
+ * bucket selects the slot, so a lookup is two hash computations and a single string compare.
+ */
+template <typename T>
+class VisNameIndex {
+public:
+    static constexpr int32_t kInvalidId = -1;
+
+    /* Contiguous range of values mapped to a single name. */
+    class Span {
+    public:
+        Span(const T* first, const T* last) : mFirst(first), mLast(last) {}
+
+        const T* begin() const { return mFirst; }
+        const T* end() const { return mLast; }
+        size_t size() const { return mLast - mFirst; }
+        bool empty() const { return mFirst == mLast; }
+    private:
+        const T* mFirst;
+        const T* mLast;
+    };
+
+    VisNameIndex() = default;
+
+    /* Builds the index from name to value multimap, e.g. std::multimap<std::string, T>. */
+    template <typename MultiMap>
+    explicit VisNameIndex(const MultiMap& mappings) {
+        // Group values by name, multimap keeps equal names together.
+        std::vector<std::string> names;
+        std::vector<std::vector<T>> values;
+        for (auto it = mappings.begin(); it != mappings.end(); ++it) {
+            if (names.empty() || names.back() != it->first) {
+                names.push_back(it->first);
+                values.emplace_back();
+            }
+            values.back().push_back(it->second);
+        }
+
+        std::vector<uint32_t> slots = buildHash(names);
+
+        // Ids are the slots of the perfect hash.
+        size_t count = names.size();
+        std::vector<uint32_t> idToName(count);
+        for (size_t i = 0; i < count; i++) {
+            idToName[slots[i]] = i;
+        }
+        mNames.reserve(count);
+        mOffsets.reserve(count + 1);
+        for (uint32_t i : idToName) {
+            mOffsets.push_back(mValues.size());
+            mValues.insert(mValues.end(), values[i].begin(), values[i].end());
+            mNames.push_back(std::move(names[i]));
+        }
+        mOffsets.push_back(mValues.size());
+    }
+
+    /*
+     * Builds the index from parts of an index built before: names in id order, the seeds of
+     * their perfect hash as returned by getSeeds() and values, the values of id i are
+     * [offsets[i], offsets[i + 1]). The hash is not rebuilt, find() fails for names the seeds
+     * don't place at their id.
+     */
+    VisNameIndex(std::vector<std::string> names, std::vector<uint32_t> seeds,
+                 std::vector<uint32_t> offsets, std::vector<T> values)
+        : mNames(std::move(names)),
+          mOffsets(std::move(offsets)),
+          mValues(std::move(values)),
+          mSeeds(std::move(seeds)) {}
+
+    /* Returns id of given name or kInvalidId if it is not mapped. */
+    int32_t find(const char* name, size_t length) const {
+        if (mNames.empty()) {
+            return kInvalidId;
+        }
+        uint32_t seed = mSeeds[hash(0, name, length) % mSeeds.size()];
+        uint32_t slot = hash(seed, name, length) % mNames.size();
+        const std::string& candidate = mNames[slot];
+        if (candidate.size() != length || memcmp(candidate.data(), name, length) != 0) {
+            return kInvalidId;
+        }
+        return static_cast<int32_t>(slot);
+    }
+
+    int32_t find(const std::string& name) const {
+        return find(name.data(), name.size());
+    }
+
+    /* Returns values mapped to given id, empty span for kInvalidId. */
+    Span getValues(int32_t id) const {
+        if (id < 0 || static_cast<size_t>(id) >= mNames.size()) {
+            return Span(nullptr, nullptr);
+        }
+        const T* data = mValues.data();
+        return Span(data + mOffsets[id], data + mOffsets[id + 1]);
+    }
+
+    const std::string& getName(int32_t id) const {
+        return mNames[id];
+    }
+
+    size_t size() const {
+        return mNames.size();
+    }
+
+    /* Seeds of the perfect hash, one per bucket, stored to rebuild the index without hashing. */
+    const std::vector<uint32_t>& getSeeds() const {
+        return mSeeds;
+    }
+
+private:
+    /* FNV-1a with seeded basis and a final avalanche, so different seeds give unrelated hashes. */
+    static uint32_t hash(uint32_t seed, const char* str, size_t length) {
+        uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (size_t i = 0; i < length; i++) {
+            h ^= static_cast<uint8_t>(str[i]);
+            h *= 16777619u;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    /* Finds seed for every bucket so all names get distinct slots. Returns slot of every name. */
+    std::vector<uint32_t> buildHash(const std::vector<std::string>& names) {
+        size_t count = names.size();
+        std::vector<uint32_t> slots(count);
+        if (count == 0) {
+            return slots;
+        }
+
+        mSeeds.assign(count, 0);
+        std::vector<std::vector<uint32_t>> buckets(count);
+        for (size_t i = 0; i < count; i++) {
+            buckets[hash(0, names[i].data(), names[i].size()) % count].push_back(i);
+        }
+        // Place the largest buckets first while most of the slots are free.
+        std::vector<uint32_t> order(count);
+        for (size_t i = 0; i < count; i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t a, uint32_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        std::vector<bool> used(count, false);
+        std::vector<uint32_t> candidate;
+        for (uint32_t b : order) {
+            const auto& bucket = buckets[b];
+            if (bucket.empty()) {
+                break;
+            }
+            for (uint32_t seed = 1;; seed++) {
+                candidate.clear();
+                for (uint32_t i : bucket) {
+                    uint32_t slot = hash(seed, names[i].data(), names[i].size()) % count;
+                    if (used[slot] ||
+                        std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+                        break;
+                    }
+                    candidate.push_back(slot);
+                }
+                if (candidate.size() == bucket.size()) {
+                    for (size_t k = 0; k < bucket.size(); k++) {
+                        used[candidate[k]] = true;
+                        slots[bucket[k]] = candidate[k];
+                    }
+                    mSeeds[b] = seed;
+                    break;
+                }
+            }
+        }
+        return slots;
+    }
+
+    std::vector<std::string> mNames;
+    std::vector<uint32_t> mOffsets;
+    std::vector<T> mValues;
+    std::vector<uint32_t> mSeeds;
+};
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif /* COMMON_INCLUDE_VHAL_V2_0_VISNAMEINDEX_H_ */
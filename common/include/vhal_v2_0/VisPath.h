@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMMON_INCLUDE_VHAL_V2_0_VISPATH_H_
+#define COMMON_INCLUDE_VHAL_V2_0_VISPATH_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+/* Returns length of the branch the VIS path is a leaf of, 0 if the path has no branch. */
+size_t getVisBranchLength(const std::string& path);
+
+/*
+ * Formats values of leaves of the same VIS branch as a single VIS set of the branch, e.g.
+ * [{"Left.Temperature":20},{"Right.Temperature":22}]. Takes pairs of the path and the value
+ * formatted by vehiclePropValueToVisString(), string values can't be set this way.
+ */
+std::string formatVisBranchSet(size_t branchLength,
+                               const std::vector<std::pair<std::string, std::string>>& values);
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif /* COMMON_INCLUDE_VHAL_V2_0_VISPATH_H_ */
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMMON_INCLUDE_VHAL_V2_0_VISSOURCECLOCK_H_
+#define COMMON_INCLUDE_VHAL_V2_0_VISSOURCECLOCK_H_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+/*
+ * Converts timestamps of VIS samples onto the local boot clock.
+ *
+ * The clocks are not synchronized, so the offset is estimated from the samples: receive time minus
+ * source time is the offset plus the transport delay, its minimum is the offset plus the smallest
+ * delay seen. The minimum is kept for the current and the previous window only, thus the estimate
+ * follows the drift of the source clock within two windows. Delays are accounted relative to the
+ * estimated offset, i.e. they exclude the smallest delay.
+ */
+class VisSourceClock {
+public:
+    static constexpr size_t kLatencyBucketCount = 8;
+
+    explicit VisSourceClock(std::chrono::nanoseconds window) : mWindow(window.count()) {}
+
+    /* Returns boot time of the sample taken at sourceTime and received at receiveTime. Latency
+     * is accounted for pushed samples only, as a fetched sample may be taken long ago. */
+    int64_t toBootTime(int64_t sourceTime, int64_t receiveTime, bool pushed = true) {
+        std::lock_guard<std::mutex> g(mLock);
+        int64_t delta = receiveTime - sourceTime;
+        if (mWindowStart == 0 || receiveTime - mWindowStart >= mWindow) {
+            mPreviousMin = mCurrentMin;
+            mCurrentMin = kNoOffset;
+            mWindowStart = receiveTime;
+        }
+        mCurrentMin = std::min(mCurrentMin, delta);
+        mOffset = std::min(mCurrentMin, mPreviousMin);
+        if (!pushed) {
+            return sourceTime + mOffset;
+        }
+
+        int64_t latency = delta - mOffset;
+        mSamples++;
+        mTotalLatency += latency;
+        mMaxLatency = std::max(mMaxLatency, latency);
+        mLatencyHistogram[latencyBucket(latency)]++;
+        return sourceTime + mOffset;
+    }
+
+    /* Returns human readable statistics, used for debug dumps. */
+    std::string dumpStats() const {
+        std::lock_guard<std::mutex> g(mLock);
+        int64_t avgLatency = mSamples > 0 ? mTotalLatency / static_cast<int64_t>(mSamples) : 0;
+        std::string out = "VIS source clock offset: " + std::to_string(mOffset) +
+                          "ns samples: " + std::to_string(mSamples) +
+                          " latency avg/max: " + std::to_string(avgLatency) + "/" +
+                          std::to_string(mMaxLatency) + "ns histogram(ms):";
+        for (size_t i = 0; i < kLatencyBucketCount; i++) {
+            out += " " + (i + 1 < kLatencyBucketCount
+                              ? "<" + std::to_string(latencyBucketBoundMs(i))
+                              : ">=" + std::to_string(latencyBucketBoundMs(i - 1))) +
+                   ":" + std::to_string(mLatencyHistogram[i]);
+        }
+        out += "\n";
+        return out;
+    }
+
+private:
+    static constexpr int64_t kNoOffset = std::numeric_limits<int64_t>::max();
+
+    static constexpr int64_t latencyBucketBoundMs(size_t bucket) {
+        constexpr int64_t kBoundsMs[kLatencyBucketCount - 1] = {1, 2, 5, 10, 20, 50, 100};
+        return kBoundsMs[bucket];
+    }
+
+    static size_t latencyBucket(int64_t latency) {
+        int64_t ms = latency / 1000000;
+        for (size_t i = 0; i + 1 < kLatencyBucketCount; i++) {
+            if (ms < latencyBucketBoundMs(i)) return i;
+        }
+        return kLatencyBucketCount - 1;
+    }
+
+    const int64_t mWindow;
+    mutable std::mutex mLock;
+    int64_t mWindowStart = 0;
+    int64_t mCurrentMin = kNoOffset;
+    int64_t mPreviousMin = kNoOffset;
+    int64_t mOffset = 0;
+    uint64_t mSamples = 0;
+    int64_t mTotalLatency = 0;
+    int64_t mMaxLatency = 0;
+    std::array<uint64_t, kLatencyBucketCount> mLatencyHistogram {};
+};
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif /* COMMON_INCLUDE_VHAL_V2_0_VISSOURCECLOCK_H_ */
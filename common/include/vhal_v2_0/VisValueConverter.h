@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMMON_INCLUDE_VHAL_V2_0_VISVALUECONVERTER_H_
+#define COMMON_INCLUDE_VHAL_V2_0_VISVALUECONVERTER_H_
+
+#include <android/hardware/automotive/vehicle/2.0/types.h>
+#include <json/json.h>
+
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+/*
+ * Writes VIS value into the vehicle value in place, returns false if it can't be converted.
+ * Sets changed if the value is changed, nothing is written if conversion fails.
+ */
+using JsonConverter = bool (*)(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                               bool* changed);
+
+/* Returns converter from VIS value to the value of given type, or nullptr if unsupported. */
+JsonConverter getJsonConverter(VehiclePropertyType type);
+
+/*
+ * Formats the value as VIS JSON value into out, reusing its storage. Strings are not quoted,
+ * out is left empty for BYTES and MIXED values.
+ */
+void vehiclePropValueToVisString(const VehiclePropValue& val, std::string* out);
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif /* COMMON_INCLUDE_VHAL_V2_0_VISVALUECONVERTER_H_ */
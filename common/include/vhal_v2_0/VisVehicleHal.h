@@ -20,13 +20,24 @@
 
 #include <vhal_v2_0/RecurrentTimer.h>
 #include <vhal_v2_0/VehicleHal.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "VisClient.h"
+#include "vhal_v2_0/VisMappingTable.h"
+#include "vhal_v2_0/VisNameIndex.h"
+#include "vhal_v2_0/VisSourceClock.h"
+#include "vhal_v2_0/VisValueConverter.h"
 #include "vhal_v2_0/VehiclePropertyStore.h"
 
 using epam::VisClient;
@@ -44,6 +55,11 @@ class VisVehicleHal : public VehicleHal {
 
  public:
     explicit VisVehicleHal(VehiclePropertyStore* propStore);
+    /* Last known values are persisted to snapshotPath, an empty path disables the snapshot. */
+    VisVehicleHal(VehiclePropertyStore* propStore, const std::string& snapshotPath);
+    /* nonBlockingGet overrides persist.vehicle.vis-nonblocking-get. */
+    VisVehicleHal(VehiclePropertyStore* propStore, const std::string& snapshotPath,
+                  bool nonBlockingGet);
     ~VisVehicleHal();
 
     //  Methods from VehicleHal
@@ -54,14 +70,86 @@ class VisVehicleHal : public VehicleHal {
     StatusCode set(const VehiclePropValue& propValue) override;
     StatusCode subscribe(int32_t property, float sampleRate) override;
     StatusCode unsubscribe(int32_t property) override;
+    std::string dump() override;
 
     VehicleHal::VehiclePropValuePtr createApPowerStateReq(VehicleApPowerStateReq state, int32_t param);
 
  private:
     void initStaticConfig();
-    void createPropertyMappingsFromConfig();
-    void subscribeToAll();
-    bool jsonToVehicle(const Json::Value& jval, struct VehiclePropValue& val);
+    bool isVisPathSubscribed(const std::string& path);
+    bool isRecentlyRefreshed(const std::string& path);
+    /* Fetches VIS path on the resync thread. */
+    void requestRefresh(const std::string& path);
+    /* Answers from the store without waiting for VIS, marks stale values UNAVAILABLE. */
+    VehiclePropValuePtr getNonBlocking(const VehiclePropValue& requestedPropValue,
+                                       StatusCode* outStatus);
+    /* Subscribes to the VIS paths requested by Android subscriptions (or to all) on the resync
+     * thread, after dropping all subscriptions if resubscribeAll is set. */
+    void requestSubscriptionSync(bool resubscribeAll);
+    /* Resync thread only. VIS round trips are made without holding mSubscriptionLock. */
+    void syncSubscriptions(bool resubscribeAll);
+    bool subscribeToVisPath(const std::string& path);
+    void applyVisValues(const epam::CommandResult& result);
+    bool refreshFromVis(const std::string& path);
+    /* Vehicle property mapped to VIS property with the converter resolved for its type. */
+    struct VisPropertyMapping {
+        VehicleAreaProperty property;
+        JsonConverter convert;
+        bool continuous;
+    };
+    /* Vehicle property to VIS mappings. Never modified once published, the whole set is
+     * replaced when the mapping file changes, thus readers keep using a consistent snapshot. */
+    struct VisMappings {
+        std::map<VehicleAreaProperty, std::string> propertyToVisName;
+        /* Built once all mappings are loaded, used to dispatch updates. */
+        VisNameIndex<VisPropertyMapping> nameIndex;
+        /* Per VIS name id, min interval between updates taken from VIS (0 for any rate) and
+         * the time the last update was taken at. */
+        mutable std::vector<std::atomic<int64_t>> ingestIntervals;
+        mutable std::vector<std::atomic<int64_t>> lastIngestTimes;
+        /* Per VIS name id, the latest update dropped by the rate limit and its receive time
+         * (0 if there is none), ids with such updates are listed in deferredIds. */
+        mutable std::mutex deferredLock;
+        mutable std::vector<Json::Value> deferredValues;
+        mutable std::vector<int64_t> deferredTimes;
+        mutable std::vector<int32_t> deferredIds;
+    };
+
+    std::shared_ptr<const VisMappings> getMappings() const {
+        return std::atomic_load(&mMappings);
+    }
+    VisPropertyMapping makePropertyMapping(const VehicleAreaProperty& prop,
+                                           const std::string& visName) const;
+    /* Sizes the per VIS name state once the name index is built. */
+    static void initNameState(VisMappings* mappings);
+    std::shared_ptr<VisMappings> buildMappings(
+        std::map<VehicleAreaProperty, std::string> propertyToVisName);
+    /* Takes the name index from the table as is, returns nullptr if its seeds don't match. */
+    std::shared_ptr<VisMappings> buildMappings(const VisMappingTable& table);
+    /* Returns the mappings of the mapping table if it is up to date, otherwise the static
+     * mappings overridden by the mapping file, compiled into the table then. Returns nullptr
+     * if the mapping file can't be parsed. */
+    std::shared_ptr<VisMappings> loadMappings();
+    /* Returns VIS paths mapped to any area of the property. */
+    static std::vector<std::string> getVisPaths(const VisMappings& mappings, int32_t property);
+    /* Limits the rate VIS paths mapped to the property are taken at by the max sample rate of
+     * subscribed continuous properties. Called under mSubscriptionLock. */
+    void updateIngestIntervals(const VisMappings& mappings, int32_t property);
+    /* Replaces mappings with static ones overridden by the mapping file, VIS paths of changed
+     * mappings are subscribed and fetched. */
+    void reloadMappings();
+    void mappingWatchLoop(const std::string& path);
+    /* Converts VIS value into the stored value in place. Returns true if it has changed, the
+     * event is set to a copy of the new value if requested. */
+    bool updateFromVis(const VisPropertyMapping& mapping, const Json::Value& jval,
+                       int64_t timestamp, VehiclePropValuePtr* event);
+    /* Returns the value of VIS sample. If the sample carries its source timestamp
+     * ({"value": ..., "ts": <ms>}), timestamp is set to it converted to the boot clock,
+     * otherwise to receiveTime. Only pushed samples are accounted in the latency statistics. */
+    const Json::Value& getSampleValue(const Json::Value& jval, int64_t receiveTime, bool pushed,
+                                      int64_t* timestamp);
+    /* Takes updates dropped by the rate limit, unless newer ones are taken meanwhile. */
+    void applyDeferredUpdates();
     void onContinuousPropertyTimer(const std::vector<int32_t>& properties);
     bool isContinuousProperty(int32_t propId) const;
     constexpr std::chrono::nanoseconds hertzToNanoseconds(float hz) const {
@@ -69,19 +157,129 @@ class VisVehicleHal : public VehicleHal {
     }
     void subscriptionHandler(const epam::CommandResult& /*result*/);
     void onVisConnectionStatusUpdate(bool);
-    bool fetchAllAndSubscribe();
-    std::string vehiclePropValueToString(VehiclePropValue val) const;
+    /* Refreshes mapped values and subscriptions after (re)connect on the resync thread. */
+    void requestResync();
+    void resyncLoop();
+    void resync();
+    /* Writes sets queued while VIS was unreachable, before mapped values are fetched. */
+    void replayOfflineWrites();
+    /* Last known values of mapped properties are persisted to be served after restart. They are
+     * written on disconnect, on shutdown and when the service stops. */
+    void loadSnapshot();
+    void saveSnapshot();
+    void requestSnapshot();
+    /* Latest value set for VIS path, sent not earlier than the due time. */
+    struct VisWrite {
+        int32_t prop;
+        int32_t areaId;
+        std::string visValue;
+        bool isString;
+        int64_t dueTime;
+    };
+    /* Returns true if VIS is unreachable and a set of the path can't be queued. */
+    bool isOfflineQueueFull(const std::string& path);
+    /* Queues the value to be written to VIS path, replaces the value pending for the path.
+     * Returns false if VIS is unreachable and the offline queue is full. */
+    bool enqueueVisWrite(const std::string& path, const VehiclePropValue& value);
+    void visWriterLoop();
+    /* Queues the write pending for the path after the one in flight, called under mWriteLock.
+     * Returns false if there is none, adds it to failed if the offline queue is full. */
+    bool requeuePendingWrite(const std::string& path, std::vector<VisWrite>* failed);
+    /* Completes the write in flight, called under mWriteLock. A write not accepted while VIS is
+     * unreachable is queued to be replayed, otherwise it is added to failed unless a newer value
+     * of the path is pending. Returns true if VIS has rejected the write. */
+    bool completeWrite(const std::string& path, VisWrite write, bool accepted,
+                       std::vector<VisWrite>* failed);
+    /* Keeps a newer queued write of the path, adds the write to failed if the queue is full.
+     * Called under mWriteLock. */
+    void queueOfflineWrite(const std::string& path, VisWrite write,
+                           std::vector<VisWrite>* failed);
+    /* Reports writes which never reach VIS to clients, called without mWriteLock. */
+    void reportFailedWrites(const std::vector<VisWrite>& writes);
 
     VehiclePropertyStore* mPropStore;
     std::unordered_set<int32_t> mHvacPowerProps;
+    /* Properties with OfflineSetPolicy::REJECT in kOfflineSetPolicies. */
+    std::unordered_set<int32_t> mOfflineRejectedSetProps;
     RecurrentTimer mRecurrentTimer;
-    std::map<VehicleAreaProperty, std::string> mVPropertyToVisName;
-    std::multimap<std::string, VehicleAreaProperty> mVisNameToVProperty;
+    /* Free values kept by every value pool above this number are released by the timer. */
+    const size_t mPoolHighWaterMark;
+    /* Mappings from DefaultConfig.h, the mapping file overrides them. */
+    std::map<VehicleAreaProperty, std::string> mStaticMappings;
+    /* Identifies the static mappings the mapping table is compiled with. */
+    uint64_t mStaticMappingsHash = 0;
+    /* Accessed with std::atomic_load() and std::atomic_store() only. */
+    std::shared_ptr<const VisMappings> mMappings;
+    /* Serializes mapping reloads. */
+    std::mutex mReloadLock;
+    std::thread mMappingWatchThread;
+    /* Signaled to stop the mapping watch thread. */
+    int mMappingWatchExitFd = -1;
+    VisSourceClock mSourceClock;
     VisClient mVisClient;
-    size_t mMainSubscriptionId;
-    bool mSubscribed;
+    /* Subscribe to all VIS properties instead of the ones Android clients are subscribed to. */
+    const bool mSubscribeToAll;
+    /* Guards Android subscriptions, held while VIS subscriptions are being made. */
+    std::mutex mSubscriptionLock;
+    std::unordered_set<int32_t> mSubscribedProperties;
+    /* Requested VIS paths with the number of subscribed properties mapped to them. */
+    std::map<std::string, size_t> mVisPathSubscribers;
+    /* Subscribed continuous properties with their sample rate. */
+    std::unordered_map<int32_t, float> mContinuousSampleRates;
+    std::atomic<uint64_t> mDroppedUpdates{0};
+    const bool mNonBlockingGet;
+    /* Serve last known values and queue sets while VIS is unreachable. */
+    const bool mOfflineMode;
+    /* Max number of VIS paths with sets queued while VIS is unreachable. */
+    const size_t mOfflineQueueSize;
+    /* Empty if last known values are not persisted. */
+    const std::string mSnapshotPath;
+    /* Resync thread only: the last written snapshot, set once values are synced with VIS. */
+    std::string mLastSnapshot;
+    bool mSnapshotValid = false;
     std::mutex mLock;
-    bool mValuesAreDirty;
+    std::mutex mSubscriptionIdsLock;
+    /* Active VIS subscriptions, path to subscription id. */
+    std::map<std::string, size_t> mVisSubscriptionIds;
+    std::atomic<bool> mValuesAreDirty;
+    /* Incremented on every disconnect. */
+    uint32_t mConnectionGeneration = 0;
+    std::thread mResyncThread;
+    std::mutex mResyncLock;
+    std::condition_variable mResyncCond;
+    bool mResyncRequested = false;
+    bool mSnapshotRequested = false;
+    bool mSubscriptionSyncRequested = false;
+    bool mResubscribeRequested = false;
+    bool mResyncExit = false;
+    /* Paths to refresh on the resync thread and the time they were last fetched. */
+    std::set<std::string> mRefreshPaths;
+    std::unordered_map<std::string, int64_t> mPathRefreshTimes;
+    /* Paths failed to be fetched on resync, fetched again at the retry time. */
+    std::set<std::string> mRetryPaths;
+    std::chrono::nanoseconds mRetryBackoff{0};
+    std::chrono::steady_clock::time_point mRetryTime;
+
+    /* Writes to VIS paths, several writes are sent as a single set of their parent branch.
+     * Returns whether every write is accepted by VIS. */
+    std::vector<bool> writeToVis(const std::vector<std::pair<std::string, VisWrite>>& writes,
+                                 size_t branchLength);
+    /* Pending writes are held for the window to coalesce quickly repeated sets. */
+    const std::chrono::nanoseconds mSetDebounce;
+    /* Max number of due writes sent in a single VIS request. */
+    const size_t mSetBatchSize;
+    std::mutex mWriteLock;
+    std::condition_variable mWriteCond;
+    /* Write waiting to be sent per VIS path, at most one write per path is in flight. */
+    std::map<std::string, VisWrite> mPendingWrites;
+    /* Paths with pending writes and no write in flight, in the order they became ready. */
+    std::deque<std::string> mReadyWritePaths;
+    std::unordered_set<std::string> mWritesInFlight;
+    /* Set while VIS is unreachable, writes are queued to be replayed on reconnect then. */
+    bool mWritesOffline = false;
+    std::map<std::string, VisWrite> mOfflineWrites;
+    bool mWriterExit = false;
+    std::vector<std::thread> mWriterThreads;
 };
 
 }  // namespace xenvm
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RecurrentTimer.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+namespace {
+
+constexpr int64_t kNanosPerSecond = 1000000000L;
+
+constexpr int64_t kJitterBucketBoundsUs[RecurrentTimer::kJitterBucketCount - 1] = {
+        50, 100, 250, 500, 1000, 5000, 10000};
+
+size_t jitterBucket(std::chrono::nanoseconds jitter) {
+    int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(jitter).count();
+    for (size_t i = 0; i + 1 < RecurrentTimer::kJitterBucketCount; i++) {
+        if (us < kJitterBucketBoundsUs[i]) return i;
+    }
+    return RecurrentTimer::kJitterBucketCount - 1;
+}
+
+std::string toHex(int32_t value) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%x", value);
+    return buf;
+}
+
+bool drainFd(int fd) {
+    uint64_t counter;
+    return read(fd, &counter, sizeof(counter)) == sizeof(counter);
+}
+
+}  // namespace
+
+RecurrentTimer::RecurrentTimer(const Action& action, Nanos timerSlack, CatchUpPolicy policy)
+    : mAction(action), mTimerSlack(timerSlack), mCatchUpPolicy(policy) {
+    mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    mWakeUpFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (mTimerFd < 0 || mWakeUpFd < 0) {
+        closeFds();
+    }
+    mTimerThread = std::thread(&RecurrentTimer::loop, this, action);
+}
+
+RecurrentTimer::~RecurrentTimer() {
+    stop();
+    closeFds();
+}
+
+void RecurrentTimer::registerRecurrentEvent(std::chrono::nanoseconds interval, int32_t cookie) {
+    TimePoint now = Clock::now();
+    // Align event time point among all intervals. Thus if we have two intervals 1ms and 2ms,
+    // during every second wake-up both intervals will be triggered.
+    TimePoint absoluteTime = now - Nanos(now.time_since_epoch().count() % interval.count());
+
+    {
+        std::lock_guard<std::mutex> g(mLock);
+        RecurrentEvent& event = mCookieToEventsMap[cookie];
+        event = { interval, cookie, absoluteTime, EventStats() };
+        event.stats.interval = interval;
+    }
+    wakeUp();
+}
+
+void RecurrentTimer::unregisterRecurrentEvent(int32_t cookie) {
+    {
+        std::lock_guard<std::mutex> g(mLock);
+        mCookieToEventsMap.erase(cookie);
+    }
+    wakeUp();
+}
+
+std::unordered_map<int32_t, RecurrentTimer::EventStats> RecurrentTimer::getStats() const {
+    std::unordered_map<int32_t, EventStats> stats;
+    std::lock_guard<std::mutex> g(mLock);
+    for (auto&& it : mCookieToEventsMap) {
+        stats.emplace(it.first, it.second.stats);
+    }
+    return stats;
+}
+
+std::string RecurrentTimer::dumpStats() const {
+    std::string out = std::string("RecurrentTimer backend: ") +
+                      (usesTimerFd() ? "timerfd" : "condition_variable") +
+                      ", slack: " + std::to_string(mTimerSlack.count()) + "ns, policy: " +
+                      (mCatchUpPolicy == CatchUpPolicy::SKIP ? "skip" : "catch-up") + "\n";
+    for (auto&& it : getStats()) {
+        const EventStats& s = it.second;
+        int64_t avgJitter = s.ticks > 1 ? s.totalJitter.count() / (s.ticks - 1) : 0;
+        out += "  cookie 0x" + toHex(it.first) +
+               " interval: " + std::to_string(s.interval.count()) + "ns" +
+               " ticks: " + std::to_string(s.ticks) +
+               " missed: " + std::to_string(s.missedTicks) +
+               " dropped: " + std::to_string(s.droppedTicks) +
+               " caught-up: " + std::to_string(s.caughtUpTicks) +
+               " jitter avg/max: " + std::to_string(avgJitter) + "/" +
+               std::to_string(s.maxJitter.count()) + "ns histogram(us):";
+        for (size_t i = 0; i < kJitterBucketCount; i++) {
+            out += " " + (i + 1 < kJitterBucketCount
+                              ? "<" + std::to_string(kJitterBucketBoundsUs[i])
+                              : ">=" + std::to_string(kJitterBucketBoundsUs[i - 1])) +
+                   ":" + std::to_string(s.jitterHistogram[i]);
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+void RecurrentTimer::RecurrentEvent::onTick(TimePoint now, CatchUpPolicy policy) {
+    Nanos jitter = now - absoluteTime;
+    // Number of further ticks which were already due by now.
+    int64_t missed = jitter / interval;
+
+    // The very first tick is aligned to the past, thus its delay is not a jitter.
+    if (stats.ticks > 0) {
+        stats.totalJitter += jitter;
+        if (jitter > stats.maxJitter) stats.maxJitter = jitter;
+        stats.jitterHistogram[jitterBucket(jitter)]++;
+    }
+    stats.ticks++;
+
+    if (policy == CatchUpPolicy::CATCH_UP) {
+        if (stats.ticks > 1 && jitter >= interval) {
+            // The slot of this tick has already passed, it is delivered as a backlog.
+            stats.missedTicks++;
+            stats.caughtUpTicks++;
+        }
+        int64_t dropped = 0;
+        if (missed > kMaxCatchUpTicks) {
+            dropped = missed - kMaxCatchUpTicks;
+            stats.droppedTicks += dropped;
+            stats.missedTicks += dropped;
+        }
+        absoluteTime += (dropped + 1) * interval;
+    } else {
+        stats.missedTicks += missed;
+        stats.droppedTicks += missed;
+        absoluteTime += (missed + 1) * interval;
+    }
+}
+
+void RecurrentTimer::loop(const Action& action) {
+    static constexpr auto kInvalidTime = TimePoint(Nanos::max());
+
+    if (mTimerSlack.count() > 0) {
+        prctl(PR_SET_TIMERSLACK, static_cast<unsigned long>(mTimerSlack.count()), 0, 0, 0);
+    }
+
+    std::vector<int32_t> cookies;
+
+    while (!mStopRequested) {
+        auto now = Clock::now();
+        auto nextEventTime = kInvalidTime;
+        cookies.clear();
+
+        {
+            std::unique_lock<std::mutex> g(mLock);
+
+            for (auto&& it : mCookieToEventsMap) {
+                RecurrentEvent& event = it.second;
+                if (event.absoluteTime <= now) {
+                    event.onTick(now, mCatchUpPolicy);
+                    cookies.push_back(event.cookie);
+                }
+
+                if (nextEventTime > event.absoluteTime) {
+                    nextEventTime = event.absoluteTime;
+                }
+            }
+        }
+
+        if (cookies.size() != 0) {
+            action(cookies);
+        }
+
+        if (usesTimerFd()) {
+            waitOnTimerFd(nextEventTime, nextEventTime == kInvalidTime);
+        } else {
+            std::unique_lock<std::mutex> g(mLock);
+            mCond.wait_until(g, nextEventTime);  // nextEventTime can be nanoseconds::max()
+        }
+    }
+}
+
+void RecurrentTimer::waitOnTimerFd(TimePoint nextEventTime, bool disarm) {
+    struct itimerspec spec = {};
+    if (!disarm) {
+        int64_t ns = nextEventTime.time_since_epoch().count();
+        spec.it_value.tv_sec = ns / kNanosPerSecond;
+        spec.it_value.tv_nsec = ns % kNanosPerSecond;
+    }
+    timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+    struct pollfd fds[2] = {};
+    fds[0].fd = mTimerFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = mWakeUpFd;
+    fds[1].events = POLLIN;
+    if (TEMP_FAILURE_RETRY(poll(fds, 2, -1)) <= 0) return;
+
+    if (fds[0].revents & POLLIN) drainFd(mTimerFd);
+    if (fds[1].revents & POLLIN) drainFd(mWakeUpFd);
+}
+
+void RecurrentTimer::wakeUp() {
+    if (usesTimerFd()) {
+        // Unlike notify_one() the event counter is not lost if the timer thread is busy
+        // running the action.
+        uint64_t one = 1;
+        if (write(mWakeUpFd, &one, sizeof(one)) != sizeof(one)) {
+            // The counter is already non-zero, the timer thread will wake up anyway.
+        }
+    } else {
+        mCond.notify_one();
+    }
+}
+
+void RecurrentTimer::closeFds() {
+    if (mTimerFd >= 0) close(mTimerFd);
+    if (mWakeUpFd >= 0) close(mWakeUpFd);
+    mTimerFd = -1;
+    mWakeUpFd = -1;
+}
+
+void RecurrentTimer::stop() {
+    mStopRequested = true;
+    {
+        std::lock_guard<std::mutex> g(mLock);
+        mCookieToEventsMap.clear();
+    }
+    wakeUp();
+    if (mTimerThread.joinable()) {
+        mTimerThread.join();
+    }
+}
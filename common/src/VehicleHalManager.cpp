@@ -168,7 +168,7 @@ Return<StatusCode> VehicleHalManager::unsubscribe(const sp<IVehicleCallback>& ca
 }
 
 Return<void> VehicleHalManager::debugDump(IVehicle::debugDump_cb _hidl_cb) {
-    _hidl_cb("");
+    _hidl_cb(mHal->dump() + mValueObjectPool.dump());
     return Void();
 }
 
@@ -186,7 +186,8 @@ void VehicleHalManager::init() {
     mHal->init(&mValueObjectPool,
                std::bind(&VehicleHalManager::onHalEvent, this, _1),
                std::bind(&VehicleHalManager::onHalPropertySetError, this,
-                         _1, _2, _3));
+                         _1, _2, _3),
+               std::bind(&VehicleHalManager::onHalEvents, this, _1));
 
     // Initialize index with vehicle configurations received from VehicleHal.
     auto supportedPropConfigs = mHal->listProperties();
@@ -212,6 +213,10 @@ void VehicleHalManager::onHalEvent(VehiclePropValuePtr v) {
     mEventQueue.push(std::move(v));
 }
 
+void VehicleHalManager::onHalEvents(std::vector<VehiclePropValuePtr> values) {
+    mEventQueue.push(std::move(values));
+}
+
 void VehicleHalManager::onHalPropertySetError(StatusCode errorCode,
                                               int32_t property,
                                               int32_t areaId) {
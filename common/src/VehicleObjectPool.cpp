@@ -18,6 +18,8 @@
 
 #include "VehicleObjectPool.h"
 
+#include <sstream>
+
 #include <log/log.h>
 
 #include "VehicleUtils.h"
@@ -30,9 +32,16 @@ namespace V2_0 {
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtain(
         VehiclePropertyType type, size_t vecSize) {
-    return isDisposable(type, vecSize)
-           ? obtainDisposable(type, vecSize)
-           : obtainRecylable(type, vecSize);
+    if (isDisposable(type, vecSize)) {
+        return obtainDisposable(type, vecSize);
+    }
+    if (VehiclePropertyType::STRING == type) {
+        return mStringPool.obtain();
+    }
+    if (VehiclePropertyType::MIXED == type) {
+        return mMixedPool.obtain();
+    }
+    return obtainRecylable(type, vecSize);
 }
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtain(
@@ -88,6 +97,52 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainComplex() {
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainRecylable(
         VehiclePropertyType type, size_t vecSize) {
+    return getRecyclablePool(type, vecSize)->obtain();
+}
+
+ObjectPool<VehiclePropValue>* VehiclePropValuePool::getPool(
+        VehiclePropertyType type, size_t vecSize) {
+    if (isDisposable(type, vecSize)) {
+        return nullptr;
+    }
+    if (VehiclePropertyType::STRING == type) {
+        return &mStringPool;
+    }
+    if (VehiclePropertyType::MIXED == type) {
+        return &mMixedPool;
+    }
+    return getRecyclablePool(type, vecSize);
+}
+
+size_t VehiclePropValuePool::getTypeIndex(VehiclePropertyType type) {
+    switch (type) {
+        case VehiclePropertyType::STRING:    return 0;
+        case VehiclePropertyType::BOOLEAN:   return 1;
+        case VehiclePropertyType::INT32:     return 2;
+        case VehiclePropertyType::INT32_VEC: return 3;
+        case VehiclePropertyType::INT64:     return 4;
+        case VehiclePropertyType::INT64_VEC: return 5;
+        case VehiclePropertyType::FLOAT:     return 6;
+        case VehiclePropertyType::FLOAT_VEC: return 7;
+        case VehiclePropertyType::BYTES:     return 8;
+        case VehiclePropertyType::MIXED:     return 9;
+        default:                             return kPoolTypeCount;
+    }
+}
+
+// Pools are never removed, so returned pointers stay valid once the lock is released.
+VehiclePropValuePool::InternalPool* VehiclePropValuePool::getRecyclablePool(
+        VehiclePropertyType type, size_t vecSize) {
+    size_t typeIndex = getTypeIndex(type);
+    std::atomic<InternalPool*>* slot = nullptr;
+    if (typeIndex < kPoolTypeCount) {
+        slot = &mRecyclablePoolTable[typeIndex * (mMaxPooledVectorSize + 1) + vecSize];
+        InternalPool* pool = slot->load(std::memory_order_acquire);
+        if (pool != nullptr) {
+            return pool;
+        }
+    }
+
     // VehiclePropertyType is not overlapping with vectorSize.
     int32_t key = static_cast<int32_t>(type)
                   | static_cast<int32_t>(vecSize);
@@ -96,10 +151,67 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainRecylable(
     auto it = mValueTypePools.find(key);
 
     if (it == mValueTypePools.end()) {
-        auto newPool(std::make_unique<InternalPool>(type, vecSize));
+        // Pools of longer vectors are rarely used, they keep a limited number of objects.
+        size_t maxMagazines = vecSize > mMaxRecyclableVectorSize ? kBoundedPoolMaxMagazines : 0;
+        auto newPool(std::make_unique<InternalPool>(type, vecSize, maxMagazines));
         it = mValueTypePools.emplace(key, std::move(newPool)).first;
     }
-    return it->second->obtain();
+    if (slot != nullptr) {
+        slot->store(it->second.get(), std::memory_order_release);
+    }
+    return it->second.get();
+}
+
+void VehiclePropValuePool::prewarm(const VehiclePropConfig& config,
+                                   const VehiclePropValue::RawValue& initialValue) {
+    VehiclePropertyType type = getPropType(config.prop);
+    size_t vecSize = getVehicleRawValueVectorSize(initialValue, type);
+    size_t count = 1;
+    if (config.changeMode == VehiclePropertyChangeMode::CONTINUOUS) {
+        count = std::max(count, config.areaConfigs.size());
+    }
+
+    auto pool = getPool(type, vecSize);
+    if (pool != nullptr) {
+        pool->prewarm(count);
+    }
+}
+
+size_t VehiclePropValuePool::trim(size_t highWaterMark) {
+    size_t released = 0;
+    std::lock_guard<std::mutex> g(mLock);
+    for (auto& it : mValueTypePools) {
+        released += it.second->trim(highWaterMark);
+    }
+    released += mStringPool.trim(highWaterMark);
+    released += mMixedPool.trim(highWaterMark);
+    return released;
+}
+
+static void dumpPoolStats(std::ostringstream& out, const char* kind, VehiclePropertyType type,
+                          size_t vecSize, const ObjectPool<VehiclePropValue>::Stats& stats) {
+    uint64_t hits = stats.obtained - std::min(stats.obtained, stats.created);
+    out << kind << " type 0x" << std::hex << toInt(type) << std::dec << " size " << vecSize
+        << ": obtained " << stats.obtained << ", hits " << hits << ", misses " << stats.created;
+    if (stats.obtained > 0) {
+        out << " (" << (hits * 100 / stats.obtained) << "% hit rate)";
+    }
+    out << ", recycled " << stats.recycled << ", released " << stats.released
+        << ", free in depot " << stats.depotObjects << "\n";
+}
+
+std::string VehiclePropValuePool::dump() const {
+    std::ostringstream out;
+    out << "Value pools:\n";
+    std::lock_guard<std::mutex> g(mLock);
+    for (auto& it : mValueTypePools) {
+        dumpPoolStats(out, it.second->isBounded() ? "  bounded" : "  fixed", it.second->getType(),
+                      it.second->getVectorSize(), it.second->getStats());
+    }
+    for (const VariablePool* pool : {&mStringPool, &mMixedPool}) {
+        dumpPoolStats(out, "  variable", pool->getType(), 0, pool->getStats());
+    }
+    return out.str();
 }
 
 VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainBoolean(
@@ -111,7 +223,7 @@ VehiclePropValuePool::RecyclableType VehiclePropValuePool::obtainDisposable(
         VehiclePropertyType valueType, size_t vectorSize) const {
     return RecyclableType {
         createVehiclePropValue(valueType, vectorSize).release(),
-        mDisposableDeleter
+        Deleter<VehiclePropValue>()
     };
 }
 
@@ -153,6 +265,36 @@ VehiclePropValue* VehiclePropValuePool::InternalPool::createObject() {
     return createVehiclePropValue(mPropType, mVectorSize).release();
 }
 
+void VehiclePropValuePool::VariablePool::recycle(VehiclePropValue* o) {
+    if (o == nullptr) {
+        ALOGE("Attempt to recycle nullptr");
+        return;
+    }
+
+    if (!check(&o->value)) {
+        // Not an error: rare huge values are not worth keeping in the pool.
+        ALOGV("Discarding value for prop 0x%x, it does not fit into the pool of type %d",
+              o->prop, toInt(mPropType));
+        delete o;
+        return;
+    }
+    if (VehiclePropertyType::MIXED == mPropType) {
+        // Users of mixed values fill only some of the fields.
+        o->value = VehiclePropValue::RawValue();
+    }
+    ObjectPool<VehiclePropValue>::recycle(o);
+}
+
+bool VehiclePropValuePool::VariablePool::check(VehiclePropValue::RawValue* v) {
+    size_t maxVectorSize = VehiclePropertyType::MIXED == mPropType ? kMaxBoundedVectorSize : 0;
+    return v->int32Values.size() <= maxVectorSize && v->floatValues.size() <= maxVectorSize &&
+           v->int64Values.size() <= maxVectorSize && v->bytes.size() <= maxVectorSize;
+}
+
+VehiclePropValue* VehiclePropValuePool::VariablePool::createObject() {
+    return createVehiclePropValue(mPropType, 0).release();
+}
+
 }  // namespace V2_0
 }  // namespace vehicle
 }  // namespace automotive
@@ -60,6 +60,27 @@ bool VehiclePropertyStore::writeValue(const VehiclePropValue& propValue,
     return true;
 }
 
+bool VehiclePropertyStore::updateValue(int32_t prop, int32_t area, int64_t timestamp,
+                                       const ValueMutator& mutator, VehiclePropValuePool* pool,
+                                       recyclable_ptr<VehiclePropValue>* event) {
+    RecordId recId = {prop, isGlobalProp(prop) ? 0 : area, 0};
+    MuxGuard g(mLock);
+    auto it = mPropertyValues.find(recId);
+    if (it == mPropertyValues.end()) {
+        ALOGW("%s: no value for property 0x%x area 0x%x", __func__, prop, area);
+        return false;
+    }
+    VehiclePropValue* value = &it->second;
+    if (!mutator(value)) {
+        return false;
+    }
+    value->timestamp = timestamp;
+    if (pool != nullptr && event != nullptr) {
+        *event = pool->obtain(*value);
+    }
+    return true;
+}
+
 void VehiclePropertyStore::removeValue(const VehiclePropValue& propValue) {
     MuxGuard g(mLock);
     RecordId recId = getRecordIdLocked(propValue);
@@ -96,6 +117,24 @@ std::vector<VehiclePropValue> VehiclePropertyStore::readValuesForProperty(int32_
     return values;
 }
 
+void VehiclePropertyStore::readValuesForProperties(
+        const std::vector<int32_t>& propIds, VehiclePropertyChangeMode changeMode,
+        const std::function<void(const VehiclePropValue&)>& visitor) const {
+    MuxGuard g(mLock);
+    for (int32_t propId : propIds) {
+        auto configIt = mConfigs.find(propId);
+        if (configIt == mConfigs.end() || configIt->second.propConfig.changeMode != changeMode) {
+            ALOGW("%s: skipping property 0x%x, no config or unexpected change mode", __func__,
+                  propId);
+            continue;
+        }
+        auto range = findRangeLocked(propId);
+        for (auto it = range.first; it != range.second; ++it) {
+            visitor(it->second);
+        }
+    }
+}
+
 std::unique_ptr<VehiclePropValue> VehiclePropertyStore::readValueOrNull(
         const VehiclePropValue& request) const {
     MuxGuard g(mLock);
@@ -20,6 +20,8 @@
 
 #include <log/log.h>
 
+#include <cstring>
+
 namespace android {
 namespace hardware {
 namespace automotive {
@@ -85,13 +87,25 @@ inline void copyHidlVec(hidl_vec <T>* dest, const hidl_vec <T>& src) {
     }
 }
 
+template<typename T>
+inline void assignHidlVec(hidl_vec <T>* dest, const hidl_vec <T>& src) {
+    // hidl_vec assignment always allocates a new buffer, reuse the existing one if possible.
+    if (dest->size() == src.size()) {
+        copyHidlVec(dest, src);
+    } else {
+        *dest = src;
+    }
+}
+
 void copyVehicleRawValue(VehiclePropValue::RawValue* dest,
                          const VehiclePropValue::RawValue& src) {
-    dest->int32Values = src.int32Values;
-    dest->floatValues = src.floatValues;
-    dest->int64Values = src.int64Values;
-    dest->bytes = src.bytes;
-    dest->stringValue = src.stringValue;
+    assignHidlVec(&dest->int32Values, src.int32Values);
+    assignHidlVec(&dest->floatValues, src.floatValues);
+    assignHidlVec(&dest->int64Values, src.int64Values);
+    assignHidlVec(&dest->bytes, src.bytes);
+    if (dest->stringValue != src.stringValue) {
+        dest->stringValue = src.stringValue;
+    }
 }
 
 template<typename T>
@@ -123,6 +137,10 @@ void shallowCopy(VehiclePropValue* dest, const VehiclePropValue& src) {
     shallowCopyHidlStr(&dest->value.stringValue, src.value.stringValue);
 }
 
+std::string toOptionalPath(const char* value) {
+    return strcmp(value, kDisabledPath) == 0 ? std::string() : std::string(value);
+}
+
 
 //}  // namespace utils
 
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "automotive.vehicle@2.0-xenvm"
+
+#include "VisMappingTable.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <log/log.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* ptr = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = TEMP_FAILURE_RETRY(write(fd, ptr, size));
+        if (written <= 0) {
+            return false;
+        }
+        ptr += written;
+        size -= written;
+    }
+    return true;
+}
+
+VisMappingTable::~VisMappingTable() {
+    if (mData != nullptr) {
+        munmap(mData, mDataSize);
+    }
+}
+
+bool VisMappingTable::load(const std::string& path, const struct stat& source,
+                           uint64_t staticHash) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        ALOGE("Unable to map property mapping table %s", path.c_str());
+        return false;
+    }
+    mData = data;
+    mDataSize = st.st_size;
+
+    const Header* header = static_cast<const Header*>(data);
+    if (header->magic != kMagic || header->version != kVersion ||
+        header->sourceSize != static_cast<uint64_t>(source.st_size) ||
+        header->sourceMtimeNs != getMtimeNs(source) || header->staticHash != staticHash) {
+        ALOGI("Property mapping table %s is outdated", path.c_str());
+        return false;
+    }
+    // Sizes are validated in 64 bits, so a corrupted header can't overflow them.
+    uint64_t entriesSize = static_cast<uint64_t>(header->entryCount) * sizeof(Entry);
+    uint64_t seedsSize = static_cast<uint64_t>(header->nameCount) * sizeof(uint32_t);
+    uint64_t offsetsSize = (static_cast<uint64_t>(header->nameCount) + 1) * sizeof(uint32_t);
+    if (sizeof(Header) + entriesSize + seedsSize + offsetsSize + header->stringsSize !=
+        mDataSize) {
+        ALOGE("Property mapping table %s is corrupted", path.c_str());
+        return false;
+    }
+    const char* base = static_cast<const char*>(data);
+    const Entry* entries = reinterpret_cast<const Entry*>(base + sizeof(Header));
+    const uint32_t* seeds =
+        reinterpret_cast<const uint32_t*>(base + sizeof(Header) + entriesSize);
+    const uint32_t* offsets = seeds + header->nameCount;
+    for (uint32_t i = 0; i < header->nameCount; i++) {
+        if (offsets[i] > offsets[i + 1]) {
+            ALOGE("Property mapping table %s is corrupted", path.c_str());
+            return false;
+        }
+    }
+    if (offsets[header->nameCount] > header->stringsSize) {
+        ALOGE("Property mapping table %s is corrupted", path.c_str());
+        return false;
+    }
+    for (uint32_t i = 0; i < header->entryCount; i++) {
+        if (entries[i].nameId >= header->nameCount ||
+            (i > 0 && entries[i].nameId < entries[i - 1].nameId)) {
+            ALOGE("Property mapping table %s is corrupted", path.c_str());
+            return false;
+        }
+    }
+
+    mHeader = header;
+    mEntries = entries;
+    mSeeds = seeds;
+    mNameOffsets = offsets;
+    mStrings = base + sizeof(Header) + entriesSize + seedsSize + offsetsSize;
+    return true;
+}
+
+bool VisMappingTable::compile(const std::vector<Mapping>& mappings,
+                              const std::vector<std::string>& names,
+                              const std::vector<uint32_t>& seeds, const struct stat& source,
+                              uint64_t staticHash, const std::string& path) {
+    std::vector<uint32_t> offsets;
+    std::string strings;
+    offsets.reserve(names.size() + 1);
+    for (const auto& name : names) {
+        offsets.push_back(strings.size());
+        strings += name;
+    }
+    offsets.push_back(strings.size());
+    Header header = {
+        .magic = kMagic,
+        .version = kVersion,
+        .sourceSize = static_cast<uint64_t>(source.st_size),
+        .sourceMtimeNs = getMtimeNs(source),
+        .staticHash = staticHash,
+        .entryCount = static_cast<uint32_t>(mappings.size()),
+        .nameCount = static_cast<uint32_t>(names.size()),
+        .stringsSize = static_cast<uint32_t>(strings.size()),
+        .reserved = 0,
+    };
+
+    // Written aside and renamed, so a table is either complete or missing. The temporary file is
+    // unique, as concurrent reloads may compile the table at the same time.
+    std::string tmpPath = path + ".XXXXXX";
+    int fd = mkstemp(&tmpPath[0]);
+    if (fd < 0) {
+        ALOGW("Unable to create property mapping table %s: %s", tmpPath.c_str(), strerror(errno));
+        return false;
+    }
+    bool written = writeAll(fd, &header, sizeof(header)) &&
+                   writeAll(fd, mappings.data(), mappings.size() * sizeof(Entry)) &&
+                   writeAll(fd, seeds.data(), seeds.size() * sizeof(uint32_t)) &&
+                   writeAll(fd, offsets.data(), offsets.size() * sizeof(uint32_t)) &&
+                   writeAll(fd, strings.data(), strings.size());
+    if (close(fd) != 0 || !written) {
+        ALOGW("Unable to write property mapping table %s", tmpPath.c_str());
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ALOGW("Unable to write property mapping table %s", path.c_str());
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VisPath.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+size_t getVisBranchLength(const std::string& path) {
+    size_t leaf = path.rfind('.');
+    return leaf == std::string::npos ? 0 : leaf;
+}
+
+std::string formatVisBranchSet(size_t branchLength,
+                               const std::vector<std::pair<std::string, std::string>>& values) {
+    // Values are relative to the branch as W3C VIS set of several signals requires.
+    std::string out = "[";
+    for (const auto& value : values) {
+        if (out.size() > 1) {
+            out += ',';
+        }
+        out += "{\"";
+        out.append(value.first, branchLength + 1, std::string::npos);
+        out += "\":";
+        out += value.second;
+        out += '}';
+    }
+    out += ']';
+    return out;
+}
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+#define LOG_TAG "automotive.vehicle@2.0-xenvm"
+
+#include <log/log.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "VisValueConverter.h"
+#include "vhal_v2_0/VehicleUtils.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+template <typename T>
+static void appendInteger(std::string* out, T value) {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out->append(buf, result.ptr);
+}
+
+/* Appends the shortest representation which is parsed back into the same float. */
+static void appendFloat(std::string* out, float value) {
+    char buf[32];
+    int length = 0;
+    // 6 significant digits are exact for most of the values, 9 are enough for any float.
+    for (int precision = 6; precision <= 9; precision++) {
+        length = snprintf(buf, sizeof(buf), "%.*g", precision, value);
+        if (strtof(buf, nullptr) == value) {
+            break;
+        }
+    }
+    out->append(buf, length);
+}
+
+template <typename Vec, typename Append>
+static void appendArray(std::string* out, const Vec& values, Append append) {
+    out->push_back('[');
+    for (size_t i = 0; i < values.size(); i++) {
+        if (i > 0) {
+            out->push_back(',');
+        }
+        append(out, values[i]);
+    }
+    out->push_back(']');
+}
+
+void vehiclePropValueToVisString(const VehiclePropValue& val, std::string* out) {
+    out->clear();
+    switch (getPropType(val.prop)) {
+        case VehiclePropertyType::STRING:
+            ALOGV("Converting VehiclePropertyType::STRING");
+            out->append(val.value.stringValue.c_str(), val.value.stringValue.size());
+            break;
+        case VehiclePropertyType::FLOAT:
+            ALOGV("Converting VehiclePropertyType::FLOAT");
+            appendFloat(out, val.value.floatValues[0]);
+            break;
+        case VehiclePropertyType::INT32:
+            ALOGV("Converting VehiclePropertyType::INT32");
+            appendInteger(out, val.value.int32Values[0]);
+            break;
+        case VehiclePropertyType::INT64:
+            ALOGV("Converting VehiclePropertyType::INT64");
+            appendInteger(out, val.value.int64Values[0]);
+            break;
+        case VehiclePropertyType::BOOLEAN:
+            ALOGV("Converting VehiclePropertyType::BOOLEAN");
+            appendInteger(out, val.value.int32Values[0]);
+            break;
+        case VehiclePropertyType::INT32_VEC:
+            ALOGV("Converting VehiclePropertyType::INT32_VEC");
+            appendArray(out, val.value.int32Values, appendInteger<int32_t>);
+            break;
+        case VehiclePropertyType::INT64_VEC:
+            ALOGV("Converting VehiclePropertyType::INT64_VEC");
+            appendArray(out, val.value.int64Values, appendInteger<int64_t>);
+            break;
+        case VehiclePropertyType::FLOAT_VEC:
+            ALOGV("Converting VehiclePropertyType::FLOAT_VEC");
+            appendArray(out, val.value.floatValues, appendFloat);
+            break;
+        case VehiclePropertyType::BYTES:
+            ALOGV("Converting VehiclePropertyType::BYTES");
+            ALOGE("Conversion from BYTES is unsupported");
+            break;
+        case VehiclePropertyType::MIXED:
+            ALOGV("Converting VehiclePropertyType::MIXED");
+            ALOGE("Conversion to MIXED is unsupported");
+            break;
+        default:
+            ALOGE("Invalid property type %d", val.prop);
+            break;
+    }
+}
+
+template <typename T>
+static inline void assignIfChanged(T* dest, T value, bool* changed) {
+    if (*dest != value) {
+        *dest = value;
+        *changed = true;
+    }
+}
+
+/*
+ * Decodes JSON array into vec in place, elements which do not fit into vec are ignored. Nothing
+ * is written unless every decoded element is valid.
+ */
+template <typename T, typename IsValid, typename Decode>
+static bool decodeJsonArray(const Json::Value& jval, hidl_vec<T>* vec, bool* changed,
+                            IsValid isValid, Decode decode) {
+    if (!jval.isArray()) {
+        return false;
+    }
+    size_t count = std::min(static_cast<size_t>(jval.size()), vec->size());
+    auto it = jval.begin();
+    for (size_t i = 0; i < count; ++it, ++i) {
+        if (!isValid(*it)) {
+            return false;
+        }
+    }
+    it = jval.begin();
+    for (size_t i = 0; i < count; ++it, ++i) {
+        assignIfChanged(&(*vec)[i], decode(*it), changed);
+    }
+    if (jval.size() > vec->size()) {
+        ALOGW("Ignoring %zu trailing elements of VIS array",
+              static_cast<size_t>(jval.size()) - vec->size());
+    }
+    return true;
+}
+
+template <typename T>
+static inline T* getScalar(hidl_vec<T>* vec, bool* changed) {
+    if (vec->size() != 1) {
+        vec->resize(1);
+        *changed = true;
+    }
+    return &(*vec)[0];
+}
+
+static bool jsonToString(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                         bool* changed) {
+    if (!jval.isString()) {
+        return false;
+    }
+    const char* str = jval.asCString();
+    if (strcmp(value->stringValue.c_str(), str) != 0) {
+        value->stringValue = str;
+        *changed = true;
+    }
+    return true;
+}
+
+static bool jsonToFloat(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                        bool* changed) {
+    if (!jval.isConvertibleTo(Json::realValue)) {
+        return false;
+    }
+    assignIfChanged(getScalar(&value->floatValues, changed), jval.asFloat(), changed);
+    return true;
+}
+
+static bool jsonToInt32(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                        bool* changed) {
+    if (!jval.isInt()) {
+        return false;
+    }
+    assignIfChanged(getScalar(&value->int32Values, changed), jval.asInt(), changed);
+    return true;
+}
+
+static bool jsonToInt64(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                        bool* changed) {
+    if (!jval.isInt64()) {
+        return false;
+    }
+    assignIfChanged(getScalar(&value->int64Values, changed),
+                    static_cast<int64_t>(jval.asInt64()), changed);
+    return true;
+}
+
+static bool jsonToBoolean(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                          bool* changed) {
+    int32_t boolValue;
+    if (jval.isBool()) {
+        boolValue = jval.asBool();
+    } else if (jval.isInt()) {
+        boolValue = static_cast<bool>(jval.asInt());
+    } else if (jval.isInt64()) {
+        boolValue = static_cast<bool>(jval.asInt64());
+    } else {
+        return false;
+    }
+    assignIfChanged(getScalar(&value->int32Values, changed), boolValue, changed);
+    return true;
+}
+
+static bool jsonToInt32Vec(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                           bool* changed) {
+    return decodeJsonArray(jval, &value->int32Values, changed,
+                           [](const Json::Value& e) { return e.isInt(); },
+                           [](const Json::Value& e) { return static_cast<int32_t>(e.asInt()); });
+}
+
+static bool jsonToInt64Vec(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                           bool* changed) {
+    return decodeJsonArray(jval, &value->int64Values, changed,
+                           [](const Json::Value& e) { return e.isInt64(); },
+                           [](const Json::Value& e) { return static_cast<int64_t>(e.asInt64()); });
+}
+
+static bool jsonToFloatVec(const Json::Value& jval, VehiclePropValue::RawValue* value,
+                           bool* changed) {
+    return decodeJsonArray(jval, &value->floatValues, changed,
+                           [](const Json::Value& e) { return e.isConvertibleTo(Json::realValue); },
+                           [](const Json::Value& e) { return e.asFloat(); });
+}
+
+JsonConverter getJsonConverter(VehiclePropertyType type) {
+    switch (type) {
+        case VehiclePropertyType::STRING:
+            return jsonToString;
+        case VehiclePropertyType::FLOAT:
+            return jsonToFloat;
+        case VehiclePropertyType::INT32:
+            return jsonToInt32;
+        case VehiclePropertyType::INT64:
+            return jsonToInt64;
+        case VehiclePropertyType::BOOLEAN:
+            return jsonToBoolean;
+        case VehiclePropertyType::INT32_VEC:
+            return jsonToInt32Vec;
+        case VehiclePropertyType::INT64_VEC:
+            return jsonToInt64Vec;
+        case VehiclePropertyType::FLOAT_VEC:
+            return jsonToFloatVec;
+        default:
+            // BYTES and MIXED can't be converted from VIS values.
+            return nullptr;
+    }
+}
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -22,15 +22,28 @@
 #include <android/log.h>
 #include <cutils/properties.h>
 #include <log/log.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <utils/SystemClock.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <future>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "DefaultConfig.h"
+#include "VisMappingTable.h"
+#include "VisPath.h"
 #include "VisVehicleHal.h"
+#include "vhal_v2_0/StartupTimeline.h"
 
 namespace android {
 namespace hardware {
@@ -42,110 +55,245 @@ using namespace impl;
 
 namespace xenvm {
 
+static std::chrono::nanoseconds getTimerSlack() {
+    return std::chrono::nanoseconds(property_get_int64("persist.vehicle.timer-slack-ns", 0));
+}
+
+static RecurrentTimer::CatchUpPolicy getTimerCatchUpPolicy() {
+    return property_get_bool("persist.vehicle.timer-catch-up", false)
+               ? RecurrentTimer::CatchUpPolicy::CATCH_UP
+               : RecurrentTimer::CatchUpPolicy::SKIP;
+}
+
+static int64_t getPoolTrimPeriodMs() {
+    return property_get_int64("persist.vehicle.pool-trim-period-ms", 10000);
+}
+
+static size_t getPoolHighWaterMark() {
+    return std::max<int64_t>(0, property_get_int64("persist.vehicle.pool-high-water", 64));
+}
+
+// Cookie of the value pool trimming on the recurrent timer, no property has this id.
+constexpr int32_t kPoolTrimCookie = toInt(VehicleProperty::INVALID);
+
+static bool getSubscribeToAll() {
+    return property_get_bool("persist.vehicle.vis-subscribe-all", false);
+}
+
+static bool getNonBlockingGet() {
+    return property_get_bool("persist.vehicle.vis-nonblocking-get", false);
+}
+
+// Values of unsubscribed VIS paths fetched earlier than this are fetched again by get, or
+// reported as stale by the non-blocking get.
+constexpr std::chrono::nanoseconds kMaxUnsubscribedValueAge = std::chrono::seconds(1);
+
+static bool getOfflineMode() {
+    return property_get_bool("persist.vehicle.vis-offline", true);
+}
+
+static size_t getOfflineQueueSize() {
+    return std::max<int64_t>(0, property_get_int64("persist.vehicle.vis-offline-queue", 64));
+}
+
+static std::string getSnapshotPath() {
+    char path[PROPERTY_VALUE_MAX] = {};
+    property_get("persist.vehicle.vis-snapshot", path, "/data/vendor/vehicle/vis-snapshot.json");
+    return toOptionalPath(path);
+}
+
+// Paths VIS failed to return on resync are fetched again with this backoff.
+constexpr std::chrono::seconds kMinRetryBackoff = std::chrono::seconds(1);
+constexpr std::chrono::seconds kMaxRetryBackoff = std::chrono::seconds(60);
+
+static size_t getResyncWorkers() {
+    return std::max<int64_t>(1, property_get_int64("persist.vehicle.vis-resync-workers", 4));
+}
+
+static std::chrono::nanoseconds getSourceClockWindow() {
+    return std::chrono::milliseconds(
+        std::max<int64_t>(1, property_get_int64("persist.vehicle.vis-clock-window-ms", 10000)));
+}
+
+static bool getWatchMappings() {
+    return property_get_bool("persist.vehicle.prop-mapping-watch", true);
+}
+
+static size_t getSetWorkers() {
+    return std::max<int64_t>(1, property_get_int64("persist.vehicle.vis-set-workers", 4));
+}
+
+static std::chrono::nanoseconds getSetDebounce() {
+    return std::chrono::milliseconds(
+        std::max<int64_t>(0, property_get_int64("persist.vehicle.vis-set-debounce-ms", 20)));
+}
+
+static size_t getSetBatchSize() {
+    return std::max<int64_t>(1, property_get_int64("persist.vehicle.vis-set-batch-size", 16));
+}
+
+/* FNV-1a of the mappings, identifies the static mappings a mapping table is compiled with. */
+static uint64_t hashMappings(
+    const std::map<VehiclePropertyStore::RecordId, std::string>& mappings) {
+    uint64_t h = 14695981039346656037ull;
+    auto add = [&h](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            h ^= static_cast<const uint8_t*>(data)[i];
+            h *= 1099511628211ull;
+        }
+    };
+    for (const auto& it : mappings) {
+        add(&it.first.prop, sizeof(it.first.prop));
+        add(&it.first.area, sizeof(it.first.area));
+        // The terminator separates the names.
+        add(it.second.c_str(), it.second.size() + 1);
+    }
+    return h;
+}
+
 VisVehicleHal::VisVehicleHal(VehiclePropertyStore* propStore)
+    : VisVehicleHal(propStore, getSnapshotPath()) {}
+
+VisVehicleHal::VisVehicleHal(VehiclePropertyStore* propStore, const std::string& snapshotPath)
+    : VisVehicleHal(propStore, snapshotPath, getNonBlockingGet()) {}
+
+VisVehicleHal::VisVehicleHal(VehiclePropertyStore* propStore, const std::string& snapshotPath,
+                             bool nonBlockingGet)
     : mPropStore(propStore),
       mHvacPowerProps(std::begin(kHvacPowerProperties), std::end(kHvacPowerProperties)),
       mRecurrentTimer(
-          std::bind(&VisVehicleHal::onContinuousPropertyTimer, this, std::placeholders::_1)) {
+          std::bind(&VisVehicleHal::onContinuousPropertyTimer, this, std::placeholders::_1),
+          getTimerSlack(), getTimerCatchUpPolicy()),
+      mPoolHighWaterMark(getPoolHighWaterMark()),
+      mSourceClock(getSourceClockWindow()),
+      mSubscribeToAll(getSubscribeToAll()),
+      mNonBlockingGet(nonBlockingGet),
+      mOfflineMode(getOfflineMode()),
+      mOfflineQueueSize(getOfflineQueueSize()),
+      mSnapshotPath(snapshotPath),
+      mSetDebounce(getSetDebounce()),
+      mSetBatchSize(getSetBatchSize()) {
     initStaticConfig();
-    mMainSubscriptionId = 0;
-    mSubscribed = false;
+    for (const auto& it : kOfflineSetPolicies) {
+        if (it.policy == OfflineSetPolicy::REJECT) {
+            mOfflineRejectedSetProps.insert(it.prop);
+        }
+    }
     mValuesAreDirty = true;
+    // Sets made before the first connection are replayed as well.
+    mWritesOffline = mOfflineMode;
 }
 
 VisVehicleHal::~VisVehicleHal() {
+    if (mMappingWatchThread.joinable()) {
+        uint64_t one = 1;
+        if (TEMP_FAILURE_RETRY(write(mMappingWatchExitFd, &one, sizeof(one))) < 0) {
+            ALOGE("Unable to stop property mapping watch: %s", strerror(errno));
+        }
+        mMappingWatchThread.join();
+    }
+    if (mMappingWatchExitFd >= 0) {
+        close(mMappingWatchExitFd);
+    }
+    {
+        std::lock_guard<std::mutex> g(mResyncLock);
+        mResyncExit = true;
+    }
+    mResyncCond.notify_one();
+    {
+        std::lock_guard<std::mutex> g(mWriteLock);
+        mWriterExit = true;
+    }
+    mWriteCond.notify_all();
     // mVisClient.unsubscribeAll();
     mVisClient.stop();
+    if (mResyncThread.joinable()) {
+        mResyncThread.join();
+    }
+    for (auto& writer : mWriterThreads) {
+        writer.join();
+    }
 }
 
 VehicleHal::VehiclePropValuePtr VisVehicleHal::get(const VehiclePropValue& requestedPropValue,
                                                    StatusCode* outStatus) {
     ALOGD("%s [GET]propId: 0x%x area: 0x%x", __func__, requestedPropValue.prop,
           requestedPropValue.areaId);
-    std::lock_guard<std::mutex> lock(mLock);
+    if (mNonBlockingGet) {
+        return getNonBlocking(requestedPropValue, outStatus);
+    }
 
     VehicleAreaProperty prop = {.prop = requestedPropValue.prop, .area = requestedPropValue.areaId};
 
-    auto it = mVPropertyToVisName.find(prop);
-    if (it != mVPropertyToVisName.end()) {
-        if ((mVisClient.getConnectedState() != epam::ConnState::STATE_CONNECTED) &&
-            mValuesAreDirty) {
-            *outStatus = StatusCode::TRY_AGAIN;
-            ALOGD("[GET] State != STATE_CONNECTED and values are dirty!");
-            return nullptr;
+    bool offline = false;
+    auto mappings = getMappings();
+    auto it = mappings->propertyToVisName.find(prop);
+    if (it != mappings->propertyToVisName.end()) {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            offline = (mVisClient.getConnectedState() != epam::ConnState::STATE_CONNECTED) &&
+                      mValuesAreDirty;
+            if (offline && !mOfflineMode) {
+                *outStatus = StatusCode::TRY_AGAIN;
+                ALOGD("[GET] State != STATE_CONNECTED and values are dirty!");
+                return nullptr;
+            }
+
+            if (mValuesAreDirty) {
+                // Serve the stored value while the resync thread refreshes it.
+                requestResync();
+            }
         }
 
-        if (mValuesAreDirty && (!fetchAllAndSubscribe())) {
-            *outStatus = StatusCode::TRY_AGAIN;
-            return nullptr;
+        /* Values of VIS paths nobody is subscribed to are not kept up to date, they are fetched
+         * once they get older than kMaxUnsubscribedValueAge. Fetched without mLock, so other
+         * gets do not wait for the round trip. */
+        if (!offline && !isVisPathSubscribed(it->second) && !isRecentlyRefreshed(it->second) &&
+            !refreshFromVis(it->second)) {
+            ALOGW("Unable to refresh VIS %s, returning stored value", it->second.c_str());
         }
     }
     VehiclePropValuePtr v = nullptr;
     auto internalPropValue = mPropStore->readValueOrNull(requestedPropValue);
     if (internalPropValue != nullptr) {
         v = getValuePool()->obtain(*internalPropValue);
+        if (offline) {
+            // The last known value, VIS can't be asked for the current one.
+            v->status = VehiclePropertyStatus::UNAVAILABLE;
+        }
     }
     *outStatus = v != nullptr ? StatusCode::OK : StatusCode::INVALID_ARG;
     return v;
 }
 
-std::string VisVehicleHal::vehiclePropValueToString(VehiclePropValue val) const {
-    switch (getPropType(val.prop)) {
-        case VehiclePropertyType::STRING:
-            ALOGV("Converting VehiclePropertyType::STRING");
-            return val.value.stringValue;
-        case VehiclePropertyType::FLOAT:
-            ALOGV("Converting VehiclePropertyType::FLOAT");
-            return std::to_string(val.value.floatValues[0]);
-        case VehiclePropertyType::INT32:
-            ALOGV("Converting VehiclePropertyType::INT32");
-            return std::to_string(val.value.int32Values[0]);
-        case VehiclePropertyType::INT64:
-            ALOGV("Converting VehiclePropertyType::INT64");
-            return std::to_string(val.value.int64Values[0]);
-        case VehiclePropertyType::BOOLEAN:
-            ALOGV("Converting VehiclePropertyType::BOOLEAN");
-            return std::to_string(val.value.int32Values[0]);
-        case VehiclePropertyType::INT32_VEC: {
-            ALOGV("Converting VehiclePropertyType::INT32_VEC");
-            std::string str = "[";
-            for (size_t i = 0; i < val.value.int32Values.size(); ++i) {
-                str += std::to_string(val.value.int32Values[i]) + ",";
-            }
-            str[str.length() - 1] = ']';
-            return str;
-        }
-        case VehiclePropertyType::INT64_VEC: {
-            ALOGV("Converting VehiclePropertyType::INT64_VEC");
-            std::string str = "[";
-            for (size_t i = 0; i < val.value.int64Values.size(); ++i) {
-                str += std::to_string(val.value.int64Values[i]) + ",";
-            }
-            str[str.length() - 1] = ']';
-            return str;
-        }
-        case VehiclePropertyType::FLOAT_VEC: {
-            ALOGV("Converting VehiclePropertyType::FLOAT_VEC");
-            std::string str = "[";
-            for (size_t i = 0; i < val.value.floatValues.size(); ++i) {
-                str += std::to_string(val.value.floatValues[i]) + ",";
-            }
-            str[str.length() - 1] = ']';
-            return str;
+VehicleHal::VehiclePropValuePtr VisVehicleHal::getNonBlocking(
+        const VehiclePropValue& requestedPropValue, StatusCode* outStatus) {
+    VehicleAreaProperty prop = {.prop = requestedPropValue.prop, .area = requestedPropValue.areaId};
+    bool stale = false;
+
+    // Never waits for VIS: stale values are served and refreshed asynchronously.
+    auto mappings = getMappings();
+    auto it = mappings->propertyToVisName.find(prop);
+    if (it != mappings->propertyToVisName.end()) {
+        if (mValuesAreDirty) {
+            stale = true;
+            requestResync();
+        } else if (!isVisPathSubscribed(it->second)) {
+            stale = !isRecentlyRefreshed(it->second);
+            requestRefresh(it->second);
+        }
+    }
+
+    VehiclePropValuePtr v = nullptr;
+    auto internalPropValue = mPropStore->readValueOrNull(requestedPropValue);
+    if (internalPropValue != nullptr) {
+        v = getValuePool()->obtain(*internalPropValue);
+        if (stale) {
+            v->status = VehiclePropertyStatus::UNAVAILABLE;
         }
-        case VehiclePropertyType::BYTES:
-            ALOGV("Converting VehiclePropertyType::BYTES");
-            ALOGE("Conversion from BYTES is unsupported");
-            return "";
-        case VehiclePropertyType::MIXED:
-            ALOGV("Converting VehiclePropertyType::MIXED");
-            ALOGE("Conversion to MIXED is unsupported");
-            return "";
-        default:
-            ALOGE("Invalid property type %d", val.prop);
-            return "";
     }
-    return "";
+    *outStatus = v != nullptr ? StatusCode::OK : StatusCode::INVALID_ARG;
+    return v;
 }
 
 VehicleHal::VehiclePropValuePtr VisVehicleHal::createApPowerStateReq(
@@ -162,7 +310,6 @@ VehicleHal::VehiclePropValuePtr VisVehicleHal::createApPowerStateReq(
 
 StatusCode VisVehicleHal::set(const VehiclePropValue& propValue) {
     ALOGD("%s [SET]propId: 0x%x area: 0x%x", __func__, propValue.prop, propValue.areaId);
-    std::lock_guard<std::mutex> lock(mLock);
 
     VehicleAreaProperty prop = {.prop = propValue.prop, .area = propValue.areaId};
 
@@ -179,9 +326,12 @@ StatusCode VisVehicleHal::set(const VehiclePropValue& propValue) {
                 // CPMS is in WAIT_FOR_FINISH state, send the FINISHED command
                 doHalEvent(createApPowerStateReq(VehicleApPowerStateReq::FINISHED, 0));
                 break;
+            case toInt(VehicleApPowerStateReport::SHUTDOWN_PREPARE):
+                // Values are persisted while CPMS prepares, the service may be killed later.
+                requestSnapshot();
+                break;
             case toInt(VehicleApPowerStateReport::ON):
             case toInt(VehicleApPowerStateReport::SHUTDOWN_POSTPONE):
-            case toInt(VehicleApPowerStateReport::SHUTDOWN_PREPARE):
                 // Do nothing
                 break;
             default:
@@ -190,30 +340,50 @@ StatusCode VisVehicleHal::set(const VehiclePropValue& propValue) {
         }
     }
 
-    auto it = mVPropertyToVisName.find(prop);
-    if (it != mVPropertyToVisName.end()) {
-        if ((mVisClient.getConnectedState() != epam::ConnState::STATE_CONNECTED) &&
-            mValuesAreDirty) {
-            ALOGD("%s [SET]propId: 0x%x", __func__, propValue.prop);
-            return StatusCode::TRY_AGAIN;
-        }
+    auto mappings = getMappings();
+    auto it = mappings->propertyToVisName.find(prop);
+    if (it == mappings->propertyToVisName.end()) {
+        return mPropStore->writeValue(propValue, false) ? StatusCode::OK
+                                                        : StatusCode::INVALID_ARG;
+    }
 
-        if (mValuesAreDirty) {
-            if (!fetchAllAndSubscribe()) return StatusCode::TRY_AGAIN;
-        }
-        ALOGD("Found mapped property 0x%x area 0x%x to vis %s", propValue.prop, propValue.areaId,
-              it->second.c_str());
-        /*std::stringstream aa;
-        aa << "\"" << it->second << "\":" << vehiclePropValueToString(propValue);*/
-        epam::Status st = mVisClient.setPropertySync(it->second , vehiclePropValueToString(propValue));
-        if (st != epam::Status::OK) {
-            ALOGE("SET retrned != OK [%d]", st);
-            return StatusCode::TRY_AGAIN;
-        }
+    if ((mVisClient.getConnectedState() != epam::ConnState::STATE_CONNECTED) &&
+        mValuesAreDirty &&
+        (!mOfflineMode || mOfflineRejectedSetProps.count(propValue.prop) > 0)) {
+        ALOGD("%s [SET]propId: 0x%x", __func__, propValue.prop);
+        return StatusCode::TRY_AGAIN;
+    }
+
+    if (mValuesAreDirty) {
+        requestResync();
+    }
+    ALOGD("Found mapped property 0x%x area 0x%x to vis %s", propValue.prop, propValue.areaId,
+          it->second.c_str());
+
+    // Checked before the value is stored, so a set rejected due to the full offline queue
+    // leaves the stored value intact.
+    if (isOfflineQueueFull(it->second)) {
+        ALOGW("Offline write queue is full, rejecting property 0x%x", propValue.prop);
+        return StatusCode::TRY_AGAIN;
     }
     if (!mPropStore->writeValue(propValue, false)) {
         return StatusCode::INVALID_ARG;
     }
+    if (!enqueueVisWrite(it->second, propValue)) {
+        // The queue was filled by a concurrent set, the stored value is fetched back from VIS
+        // on reconnect.
+        ALOGW("Offline write queue is full, rejecting property 0x%x", propValue.prop);
+        return StatusCode::TRY_AGAIN;
+    }
+
+    // Stored optimistically, failure is reported via onPropertySetError.
+    // The value VIS echoes back is not a change any more, thus subscribers are notified now.
+    if (!isContinuousProperty(propValue.prop)) {
+        auto stored = mPropStore->readValueOrNull(propValue);
+        if (stored != nullptr) {
+            doHalEvent(getValuePool()->obtain(*stored));
+        }
+    }
 
     return StatusCode::OK;
 }
@@ -224,7 +394,24 @@ std::vector<VehiclePropConfig> VisVehicleHal::listProperties() {
 
 StatusCode VisVehicleHal::subscribe(int32_t property, float sampleRate) {
     ALOGI("%s propId: 0x%x, sampleRate: %f", __func__, property, sampleRate);
-    fetchAllAndSubscribe();
+    bool added = false;
+    {
+        std::lock_guard<std::mutex> lock(mSubscriptionLock);
+        auto mappings = getMappings();
+        if (!mSubscribeToAll && mSubscribedProperties.insert(property).second) {
+            for (const auto& path : getVisPaths(*mappings, property)) {
+                added = mVisPathSubscribers[path]++ == 0 || added;
+            }
+        }
+        if (isContinuousProperty(property)) {
+            mContinuousSampleRates[property] = sampleRate;
+            updateIngestIntervals(*mappings, property);
+        }
+    }
+    if (added) {
+        // Not waiting for VIS here, get fetches the paths until they are subscribed.
+        requestSubscriptionSync(false);
+    }
     if (isContinuousProperty(property)) {
         mRecurrentTimer.registerRecurrentEvent(hertzToNanoseconds(sampleRate), property);
     }
@@ -233,41 +420,105 @@ StatusCode VisVehicleHal::subscribe(int32_t property, float sampleRate) {
 
 StatusCode VisVehicleHal::unsubscribe(int32_t property) {
     ALOGI("%s propId: 0x%x", __func__, property);
+    {
+        std::lock_guard<std::mutex> lock(mSubscriptionLock);
+        auto mappings = getMappings();
+        if (!mSubscribeToAll && mSubscribedProperties.erase(property) > 0) {
+            bool removed = false;
+            for (const auto& path : getVisPaths(*mappings, property)) {
+                auto it = mVisPathSubscribers.find(path);
+                if (it != mVisPathSubscribers.end() && --it->second == 0) {
+                    mVisPathSubscribers.erase(it);
+                    removed = true;
+                }
+            }
+            if (removed) {
+                // VisClient can only drop all subscriptions at once.
+                requestSubscriptionSync(true);
+            }
+        }
+        if (mContinuousSampleRates.erase(property) > 0) {
+            updateIngestIntervals(*mappings, property);
+        }
+    }
     if (isContinuousProperty(property)) {
         mRecurrentTimer.unregisterRecurrentEvent(property);
     }
     return StatusCode::OK;
 }
 
+void VisVehicleHal::updateIngestIntervals(const VisMappings& mappings, int32_t property) {
+    for (const auto& path : getVisPaths(mappings, property)) {
+        int32_t id = mappings.nameIndex.find(path);
+        float maxSampleRate = 0;
+        for (const VisPropertyMapping& mapping : mappings.nameIndex.getValues(id)) {
+            auto rate = mContinuousSampleRates.find(mapping.property.prop);
+            if (!mapping.continuous || rate == mContinuousSampleRates.end()) {
+                // Every update is needed for on-change events or for get.
+                maxSampleRate = 0;
+                break;
+            }
+            maxSampleRate = std::max(maxSampleRate, rate->second);
+        }
+        // Twice the sample rate, so the sampled value is never older than half of the period.
+        int64_t interval =
+            maxSampleRate > 0 ? static_cast<int64_t>(1000000000L / (2 * maxSampleRate)) : 0;
+        if (id != VisNameIndex<VisPropertyMapping>::kInvalidId) {
+            mappings.ingestIntervals[id].store(interval, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::string VisVehicleHal::dump() {
+    return StartupTimeline::instance()->dump() + mRecurrentTimer.dumpStats() +
+           mSourceClock.dumpStats() +
+           "VIS updates dropped by rate limit: " + std::to_string(mDroppedUpdates.load()) + "\n";
+}
+
 void VisVehicleHal::subscriptionHandler(const epam::CommandResult& result) {
+    int64_t receiveTime = elapsedRealtimeNano();
+    // The whole update is dispatched with the same mappings even if they are being reloaded.
+    auto mappings = getMappings();
+    const auto& index = mappings->nameIndex;
     for (auto& item : result) {
         /* Several vehicle properties may be mapped to one VIS property. Will find & update all of
          * these. */
-        auto range = mVisNameToVProperty.equal_range(item.first);
-        for (auto it = range.first; it != range.second; ++it) {
+        int32_t id = index.find(item.first);
+        if (id == VisNameIndex<VisPropertyMapping>::kInvalidId) {
+            continue;
+        }
+        int64_t interval = mappings->ingestIntervals[id].load(std::memory_order_relaxed);
+        if (interval > 0) {
+            // Faster than subscribed clients sample the path, drop it before decoding.
+            auto& lastIngestTime = mappings->lastIngestTimes[id];
+            std::lock_guard<std::mutex> g(mappings->deferredLock);
+            if (receiveTime - lastIngestTime.load(std::memory_order_relaxed) < interval) {
+                mDroppedUpdates.fetch_add(1, std::memory_order_relaxed);
+                // VIS may not push the path again, the latest value is taken on the next sample.
+                if (mappings->deferredTimes[id] == 0) {
+                    mappings->deferredIds.push_back(id);
+                }
+                mappings->deferredValues[id] = item.second;
+                mappings->deferredTimes[id] = receiveTime;
+                continue;
+            }
+            lastIngestTime.store(receiveTime, std::memory_order_relaxed);
+            // Superseded by this update.
+            mappings->deferredTimes[id] = 0;
+        }
+        int64_t timestamp;
+        const Json::Value& jval = getSampleValue(item.second, receiveTime, true, &timestamp);
+        for (const VisPropertyMapping& mapping : index.getValues(id)) {
             ALOGV("Will convert VIS property %s to vehicle prop", item.first.c_str());
-            auto valResult = mPropStore->readValueOrNull(it->second.prop, it->second.area);
-            if (valResult) {
-                auto val = valResult.get();
-                if (jsonToVehicle(item.second, *val)) {
-                    if (mPropStore->writeValue(*val, true)) {
-                        ALOGV("Value for property %d area=%d|%s updated to %s", it->second.prop,
-                              it->second.area, it->first.c_str(),
-                              vehiclePropValueToString(*val).c_str());
-                        /* Do not send updates for continuos properties*/
-                        if (!isContinuousProperty(val->prop)) {
-                            auto v = getValuePool()->obtain(*val);
-                            v->timestamp = elapsedRealtimeNano();
-                            doHalEvent(std::move(v));
-                        }
-                    } else {
-                        ALOGE("Unable to update property %d area=%d|%s", it->second.prop,
-                              it->second.area, it->first.c_str());
-                    }
+            const VehicleAreaProperty& prop = mapping.property;
+            /* Do not send updates for continuos properties*/
+            VehiclePropValuePtr v;
+            if (updateFromVis(mapping, jval, timestamp, mapping.continuous ? nullptr : &v)) {
+                ALOGV("Value for property %d area=%d|%s updated", prop.prop, prop.area,
+                      item.first.c_str());
+                if (v) {
+                    doHalEvent(std::move(v));
                 }
-            } else {
-                ALOGE("Unable to read current value for prop 0x%x area=0x%x from propertystore",
-                      it->second.prop, it->second.area);
             }
         }
     }
@@ -294,60 +545,285 @@ void VisVehicleHal::subscriptionHandler(const epam::CommandResult& result) {
 #endif
 }
 
-void VisVehicleHal::createPropertyMappingsFromConfig() {
+std::shared_ptr<VisVehicleHal::VisMappings> VisVehicleHal::loadMappings() {
     char propValue[PROPERTY_VALUE_MAX] = {};
     property_get("persist.vehicle.prop-mapping", propValue,
                  "/vendor/etc/vehicle/vehicle-mappings.json");
-    std::ifstream configFile(propValue);
-    if (configFile.is_open()) {
-        Json::Value root;
-        Json::Reader reader;
-        if (reader.parse(configFile, root, false)) {
-            if (root.isArray()) {
-                for (unsigned int i = 0; i < root.size(); i++) {
-                    Json::Value val = root[i];
-                    int androidId = val["android-property-id"].asInt();
-                    int areaId = val["area-id"].asInt();
-                    std::string androidString = val["android-property-id-as-string"].asString();
-                    std::string visString = val["vis-property"].asString();
-                    std::string description = val["description"].asString();
-                    ALOGD("Mapping (%s,0x%x,0x%x) => (%s) [%s]", androidString.c_str(), androidId,
-                          areaId, visString.c_str(), description.c_str());
-
-                    VehicleAreaProperty prop = {
-                        .prop = androidId,
-                        .area = areaId,
-                    };
-                    auto it = mVPropertyToVisName.find(prop);
-                    if (it != mVPropertyToVisName.end()) {
-                        mVPropertyToVisName.erase(prop);
-                        auto range = mVisNameToVProperty.equal_range(it->second);
-                        for (auto iit = range.first; iit != range.second; ++iit) {
-                            if (iit->second == prop) {
-                                mVisNameToVProperty.erase(iit);
-                                break;
-                            }
-                        }
-                    }
-                    mVPropertyToVisName.emplace(prop, visString);
-                    mVisNameToVProperty.emplace(visString, prop);
-                }
+    struct stat source;
+    if (stat(propValue, &source) != 0) {
+        ALOGE("Unable to open property mapping file %s", propValue);
+        // abort();
+        return buildMappings(mStaticMappings);
+    }
+
+    char tableValue[PROPERTY_VALUE_MAX] = {};
+    property_get("persist.vehicle.prop-mapping-table", tableValue,
+                 "/data/vendor/vehicle/vehicle-mappings.bin");
+    std::string tablePath = toOptionalPath(tableValue);
+    if (!tablePath.empty()) {
+        VisMappingTable table;
+        if (table.load(tablePath, source, mStaticMappingsHash)) {
+            ALOGI("Loading %zu mappings from %s", table.size(), tablePath.c_str());
+            auto mappings = buildMappings(table);
+            if (mappings != nullptr) {
+                return mappings;
             }
-        } else {
-            ALOGE("Property config parsing failed %s", reader.getFormatedErrorMessages().c_str());
-            // abort();
+            ALOGE("Property mapping table %s doesn't match its names", tablePath.c_str());
         }
+    }
 
-    } else {
+    std::ifstream configFile(propValue);
+    if (!configFile.is_open()) {
         ALOGE("Unable to open property mapping file %s", propValue);
         // abort();
+        return buildMappings(mStaticMappings);
+    }
+    Json::Value root;
+    Json::Reader reader;
+    if (!reader.parse(configFile, root, false)) {
+        ALOGE("Property config parsing failed %s", reader.getFormatedErrorMessages().c_str());
+        // abort();
+        return nullptr;
+    }
+    std::map<VehicleAreaProperty, std::string> propertyToVisName = mStaticMappings;
+    if (root.isArray()) {
+        for (unsigned int i = 0; i < root.size(); i++) {
+            const Json::Value& val = root[i];
+            int androidId = val["android-property-id"].asInt();
+            int areaId = val["area-id"].asInt();
+            std::string androidString = val["android-property-id-as-string"].asString();
+            std::string visString = val["vis-property"].asString();
+            std::string description = val["description"].asString();
+            ALOGD("Mapping (%s,0x%x,0x%x) => (%s) [%s]", androidString.c_str(), androidId,
+                  areaId, visString.c_str(), description.c_str());
+
+            VehicleAreaProperty prop = {
+                .prop = androidId,
+                .area = areaId,
+            };
+            propertyToVisName[prop] = std::move(visString);
+        }
+    }
+    auto mappings = buildMappings(std::move(propertyToVisName));
+    if (tablePath.empty()) {
+        return mappings;
+    }
+
+    // The table keeps the perfect hash of the index, so it is not rebuilt on the next start.
+    const auto& index = mappings->nameIndex;
+    std::vector<std::string> names;
+    std::vector<VisMappingTable::Mapping> tableMappings;
+    names.reserve(index.size());
+    tableMappings.reserve(mappings->propertyToVisName.size());
+    for (size_t id = 0; id < index.size(); id++) {
+        names.push_back(index.getName(id));
+        for (const VisPropertyMapping& mapping : index.getValues(id)) {
+            tableMappings.push_back(VisMappingTable::Mapping{
+                mapping.property.prop, mapping.property.area, static_cast<uint32_t>(id)});
+        }
+    }
+    if (VisMappingTable::compile(tableMappings, names, index.getSeeds(), source,
+                                 mStaticMappingsHash, tablePath)) {
+        ALOGI("Compiled %s into %s", propValue, tablePath.c_str());
+    }
+    return mappings;
+}
+
+VisVehicleHal::VisPropertyMapping VisVehicleHal::makePropertyMapping(
+    const VehicleAreaProperty& prop, const std::string& visName) const {
+    JsonConverter convert = getJsonConverter(getPropType(prop.prop));
+    if (convert == nullptr) {
+        ALOGW("Conversion from VIS %s to property 0x%x is unsupported", visName.c_str(),
+              prop.prop);
+    }
+    return VisPropertyMapping{prop, convert, isContinuousProperty(prop.prop)};
+}
+
+void VisVehicleHal::initNameState(VisMappings* mappings) {
+    size_t count = mappings->nameIndex.size();
+    mappings->ingestIntervals = std::vector<std::atomic<int64_t>>(count);
+    mappings->lastIngestTimes = std::vector<std::atomic<int64_t>>(count);
+    mappings->deferredValues.resize(count);
+    mappings->deferredTimes.assign(count, 0);
+}
+
+std::shared_ptr<VisVehicleHal::VisMappings> VisVehicleHal::buildMappings(
+    std::map<VehicleAreaProperty, std::string> propertyToVisName) {
+    auto mappings = std::make_shared<VisMappings>();
+    mappings->propertyToVisName = std::move(propertyToVisName);
+
+    std::multimap<std::string, VisPropertyMapping> visNameToProperty;
+    for (const auto& it : mappings->propertyToVisName) {
+        visNameToProperty.emplace(it.second, makePropertyMapping(it.first, it.second));
+    }
+    mappings->nameIndex = VisNameIndex<VisPropertyMapping>(visNameToProperty);
+    initNameState(mappings.get());
+    return mappings;
+}
+
+std::shared_ptr<VisVehicleHal::VisMappings> VisVehicleHal::buildMappings(
+    const VisMappingTable& table) {
+    auto mappings = std::make_shared<VisMappings>();
+    size_t count = table.getNameCount();
+    std::vector<std::string> names;
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> offsets;
+    std::vector<VisPropertyMapping> values;
+    names.reserve(count);
+    seeds.reserve(count);
+    offsets.reserve(count + 1);
+    values.reserve(table.size());
+    size_t entry = 0;
+    for (uint32_t id = 0; id < count; id++) {
+        names.push_back(table.getVisName(id));
+        seeds.push_back(table.getSeed(id));
+        offsets.push_back(values.size());
+        // Entries are ordered by the name id.
+        for (; entry < table.size() && table.getNameId(entry) == id; entry++) {
+            VehicleAreaProperty prop = {
+                .prop = table.getProperty(entry),
+                .area = table.getArea(entry),
+            };
+            mappings->propertyToVisName.emplace(prop, names.back());
+            values.push_back(makePropertyMapping(prop, names.back()));
+        }
+    }
+    offsets.push_back(values.size());
+    mappings->nameIndex = VisNameIndex<VisPropertyMapping>(std::move(names), std::move(seeds),
+                                                           std::move(offsets), std::move(values));
+    // Checking the seeds is a lookup per name, far cheaper than finding them.
+    for (size_t id = 0; id < count; id++) {
+        if (mappings->nameIndex.find(mappings->nameIndex.getName(id)) != static_cast<int32_t>(id)) {
+            return nullptr;
+        }
+    }
+    initNameState(mappings.get());
+    return mappings;
+}
+
+void VisVehicleHal::reloadMappings() {
+    // The resync and the watch threads may reload at once, the last read file must win.
+    std::lock_guard<std::mutex> reloadLock(mReloadLock);
+    std::shared_ptr<const VisMappings> mappings = loadMappings();
+    if (mappings == nullptr) {
+        ALOGE("Keeping current property mappings");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mSubscriptionLock);
+    auto oldMappings = getMappings();
+    // VIS paths mapped properties take their values from now.
+    std::set<std::string> changedPaths;
+    for (const auto& it : mappings->propertyToVisName) {
+        auto old = oldMappings->propertyToVisName.find(it.first);
+        if (old == oldMappings->propertyToVisName.end() || old->second != it.second) {
+            changedPaths.insert(it.second);
+        }
+    }
+    for (const auto& rate : mContinuousSampleRates) {
+        updateIngestIntervals(*mappings, rate.first);
+    }
+    std::atomic_store(&mMappings, mappings);
+    ALOGI("Property mappings are reloaded, %zu VIS paths are changed", changedPaths.size());
+
+    if (!mSubscribeToAll) {
+        std::map<std::string, size_t> pathSubscribers;
+        for (int32_t property : mSubscribedProperties) {
+            for (const auto& path : getVisPaths(*mappings, property)) {
+                pathSubscribers[path]++;
+            }
+        }
+        bool removed = false;
+        for (const auto& it : mVisPathSubscribers) {
+            removed = removed || pathSubscribers.count(it.first) == 0;
+        }
+        std::vector<std::string> added;
+        for (const auto& it : pathSubscribers) {
+            if (mVisPathSubscribers.count(it.first) == 0) {
+                added.push_back(it.first);
+            }
+        }
+        mVisPathSubscribers.swap(pathSubscribers);
+        if (removed || !added.empty()) {
+            // VisClient can only drop all subscriptions at once.
+            requestSubscriptionSync(removed);
+        }
+    }
+    // Everything is fetched on resync otherwise.
+    if (!mValuesAreDirty) {
+        for (const auto& path : changedPaths) {
+            requestRefresh(path);
+        }
+    }
+}
+
+void VisVehicleHal::mappingWatchLoop(const std::string& path) {
+    // The directory is watched, as the file is usually replaced rather than written in place.
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    int fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd < 0 ||
+        inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0) {
+        ALOGW("Unable to watch property mapping file %s: %s", path.c_str(), strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
     }
+
+    alignas(struct inotify_event) char buf[4096];
+    struct pollfd fds[2] = {
+        {.fd = fd, .events = POLLIN, .revents = 0},
+        {.fd = mMappingWatchExitFd, .events = POLLIN, .revents = 0},
+    };
+    while (TEMP_FAILURE_RETRY(poll(fds, 2, -1)) > 0 && (fds[1].revents & POLLIN) == 0) {
+        bool changed = false;
+        ssize_t len;
+        while ((len = read(fd, buf, sizeof(buf))) > 0) {
+            for (char* ptr = buf; ptr < buf + len;) {
+                auto event = reinterpret_cast<const struct inotify_event*>(ptr);
+                changed = changed || (event->len > 0 && name == event->name);
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed) {
+            reloadMappings();
+        }
+    }
+    close(fd);
 }
 
 void VisVehicleHal::onVisConnectionStatusUpdate(bool connected) {
-    std::lock_guard<std::mutex> lock(mLock);
     ALOGI("Received connection state update to %d from VisClient", connected);
-    if (!connected) mValuesAreDirty = true;
+    if (!connected) {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mValuesAreDirty = true;
+            mConnectionGeneration++;
+        }
+        if (mOfflineMode) {
+            std::vector<VisWrite> dropped;
+            {
+                std::lock_guard<std::mutex> g(mWriteLock);
+                mWritesOffline = true;
+                // Writes not sent yet are replayed on reconnect, as far as the queue allows.
+                for (const auto& path : mReadyWritePaths) {
+                    auto write = mPendingWrites.find(path);
+                    queueOfflineWrite(path, std::move(write->second), &dropped);
+                    mPendingWrites.erase(write);
+                }
+                mReadyWritePaths.clear();
+            }
+            reportFailedWrites(dropped);
+        }
+        // Stored values are the last known ones until reconnect.
+        requestSnapshot();
+    } else {
+        StartupTimeline::instance()->mark("vis-connected");
+        requestResync();
+    }
 }
 
 // Parse supported properties list and generate vector of property values to hold current values.
@@ -395,8 +871,7 @@ void VisVehicleHal::onCreate() {
                     ALOGD("Found mapping prop 0x%x area 0x%x to vis %s", cfg.prop, curArea,
                           areaToVis->second.c_str());
                     VehicleAreaProperty prop = {.prop = cfg.prop, .area = curArea};
-                    mVPropertyToVisName.emplace(prop, areaToVis->second);
-                    mVisNameToVProperty.emplace(areaToVis->second, prop);
+                    mStaticMappings.emplace(prop, areaToVis->second);
 
                 } else {
                     ALOGE("Failed to find prop 0x%x area 0x%x mapping to vis", cfg.prop, curArea);
@@ -404,91 +879,667 @@ void VisVehicleHal::onCreate() {
             }
 
             mPropStore->writeValue(prop, shouldUpdateStatus);
+            if (i == 0) {
+                getValuePool()->prewarm(cfg, prop.value);
+            }
         }
     }
+    int64_t trimPeriodMs = getPoolTrimPeriodMs();
+    if (trimPeriodMs > 0) {
+        mRecurrentTimer.registerRecurrentEvent(std::chrono::milliseconds(trimPeriodMs),
+                                               kPoolTrimCookie);
+    }
+    StartupTimeline::instance()->mark("store-initialized");
 
     std::function<void(bool)> connHandler =
         std::bind(&VisVehicleHal::onVisConnectionStatusUpdate, this, std::placeholders::_1);
-    createPropertyMappingsFromConfig();
+    /* Loaded before the service is registered, so sets of properties mapped by the file are
+     * never taken for unmapped ones. The precompiled table is only mapped into memory. */
+    mStaticMappingsHash = hashMappings(mStaticMappings);
+    std::shared_ptr<const VisMappings> mappings = loadMappings();
+    if (mappings == nullptr) {
+        mappings = buildMappings(mStaticMappings);
+    }
+    std::atomic_store(&mMappings, mappings);
+    StartupTimeline::instance()->mark("mappings-loaded");
+    if (getWatchMappings()) {
+        char mappingPath[PROPERTY_VALUE_MAX] = {};
+        property_get("persist.vehicle.prop-mapping", mappingPath,
+                     "/vendor/etc/vehicle/vehicle-mappings.json");
+        mMappingWatchExitFd = eventfd(0, EFD_CLOEXEC);
+        if (mMappingWatchExitFd >= 0) {
+            mMappingWatchThread =
+                std::thread(&VisVehicleHal::mappingWatchLoop, this, std::string(mappingPath));
+        }
+    }
     mVisClient.registerServerConnectionhandler(connHandler);
+    mResyncThread = std::thread(&VisVehicleHal::resyncLoop, this);
+    for (size_t i = 0; i < getSetWorkers(); i++) {
+        mWriterThreads.emplace_back(&VisVehicleHal::visWriterLoop, this);
+    }
     mVisClient.start();
-    subscribeToAll();
+    StartupTimeline::instance()->mark("vis-client-started");
+    requestResync();
+}
+
+std::vector<std::string> VisVehicleHal::getVisPaths(const VisMappings& mappings,
+                                                    int32_t property) {
+    std::vector<std::string> paths;
+    for (const auto& it : mappings.propertyToVisName) {
+        if (it.first.prop == property &&
+            std::find(paths.begin(), paths.end(), it.second) == paths.end()) {
+            paths.push_back(it.second);
+        }
+    }
+    return paths;
+}
+
+bool VisVehicleHal::isVisPathSubscribed(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mSubscriptionIdsLock);
+    return mVisSubscriptionIds.count(mSubscribeToAll ? VisClient::kAllTag : path) > 0;
+}
+
+void VisVehicleHal::requestSubscriptionSync(bool resubscribeAll) {
+    {
+        std::lock_guard<std::mutex> g(mResyncLock);
+        mSubscriptionSyncRequested = true;
+        mResubscribeRequested = mResubscribeRequested || resubscribeAll;
+    }
+    mResyncCond.notify_one();
 }
 
-void VisVehicleHal::subscribeToAll() {
-    // Subscribe to all
-    ALOGV("Will try to subscribe to all VIS properties");
+void VisVehicleHal::syncSubscriptions(bool resubscribeAll) {
+    {
+        // Requests made from now on see the paths collected below or are handled next time.
+        std::lock_guard<std::mutex> g(mResyncLock);
+        resubscribeAll = resubscribeAll || mResubscribeRequested;
+        mSubscriptionSyncRequested = false;
+        mResubscribeRequested = false;
+    }
+    std::vector<std::string> paths;
+    {
+        std::lock_guard<std::mutex> lock(mSubscriptionLock);
+        if (mSubscribeToAll) {
+            paths.push_back(VisClient::kAllTag);
+        } else {
+            for (const auto& it : mVisPathSubscribers) {
+                paths.push_back(it.first);
+            }
+        }
+    }
+    if (resubscribeAll) {
+        // Subscriptions are lost with the connection, thus all of them are created again.
+        mVisClient.unsubscribeAll();
+        std::lock_guard<std::mutex> lock(mSubscriptionIdsLock);
+        mVisSubscriptionIds.clear();
+    }
+    for (const auto& path : paths) {
+        bool subscribed;
+        {
+            std::lock_guard<std::mutex> lock(mSubscriptionIdsLock);
+            subscribed = mVisSubscriptionIds.count(path) > 0;
+        }
+        if (!subscribed) {
+            subscribeToVisPath(path);
+        }
+    }
+}
+
+bool VisVehicleHal::subscribeToVisPath(const std::string& path) {
+    ALOGV("Will try to subscribe to VIS %s", path.c_str());
     std::future<epam::WMessageResult> f;
-    std::string str(VisClient::kAllTag);
 
     std::function<void(const epam::CommandResult&)> resultHandler =
         std::bind(&VisVehicleHal::subscriptionHandler, this, std::placeholders::_1);
 
-    epam::Status st = mVisClient.subscribeProperty(str, resultHandler, f);
+    epam::Status st = mVisClient.subscribeProperty(path, resultHandler, f);
     ALOGV("Subscribe retrned OK = %d", st == epam::Status::OK);
     if (st !=  epam::Status::OK) {
-        ALOGE("Subscription is failed : %d", st);
-        return;
+        ALOGE("Subscription to %s is failed : %d", path.c_str(), st);
+        return false;
     }
     if (!f.valid()) {
         ALOGE("Unable to subscribe: future is not valid !");
-        return;
+        return false;
     }
     if (f.wait_for(std::chrono::seconds(4)) != std::future_status::ready) {
         ALOGE("Unable to receive result, timeout %d !!!!", 4);
-        return;
+        return false;
     }
     epam::WMessageResult sr = f.get();
-    if (sr.status == epam::Status::OK) {
-        mMainSubscriptionId = sr.subscriptionId;
-        ALOGV("Subscribed with id =%zu", mMainSubscriptionId);
-        mSubscribed = true;
+    if (sr.status != epam::Status::OK) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mSubscriptionIdsLock);
+        mVisSubscriptionIds[path] = sr.subscriptionId;
     }
+    ALOGV("Subscribed to %s with id =%zu", path.c_str(), sr.subscriptionId);
+    return true;
 }
 
-bool VisVehicleHal::fetchAllAndSubscribe() {
-    if ((mValuesAreDirty == true) &&
-        (mVisClient.getConnectedState() == epam::ConnState::STATE_CONNECTED)) {
-        epam::WMessageResult sr;
-        epam::Status st = mVisClient.getPropertySync(VisClient::kAllTag, sr);
-        if (st != epam::Status::OK) {
-            ALOGE("Unable to get * from VIS");
-            return false;
+void VisVehicleHal::applyVisValues(const epam::CommandResult& result) {
+    int64_t receiveTime = elapsedRealtimeNano();
+    auto mappings = getMappings();
+    const auto& index = mappings->nameIndex;
+    for (auto& item : result) {
+        int32_t id = index.find(item.first);
+        int64_t timestamp = receiveTime;
+        const Json::Value& jval = id == VisNameIndex<VisPropertyMapping>::kInvalidId
+                                      ? item.second
+                                      : getSampleValue(item.second, receiveTime, false, &timestamp);
+        for (const VisPropertyMapping& mapping : index.getValues(id)) {
+            ALOGV("Will convert VIS property %s to vehicle prop", item.first.c_str());
+            // Changes found by a fetch, e.g. a rejected set rolled back, are reported as well.
+            VehiclePropValuePtr v;
+            if (updateFromVis(mapping, jval, timestamp, mapping.continuous ? nullptr : &v)) {
+                ALOGV("Value for property %d area= %d|%s updated", mapping.property.prop,
+                      mapping.property.area, item.first.c_str());
+                if (v) {
+                    doHalEvent(std::move(v));
+                }
+            }
         }
-        ALOGI("Fetched all from VIS!");
-        auto result = sr.commandResult;
-
-        for (auto& item : result) {
-            auto it = mVisNameToVProperty.find(item.first);
-            if (it != mVisNameToVProperty.end()) {
-                ALOGV("Will convert VIS property %s to vehicle prop", item.first.c_str());
-                auto result = mPropStore->readValueOrNull(it->second.prop, it->second.area);
-                if (result) {
-                    auto val = result.get();
-                    if (jsonToVehicle(item.second, *val)) {
-                        ALOGV("Result converted !");
-                        if (mPropStore->writeValue(*val, false)) {
-                            ALOGV("Value for property %d area= %d|%s updated", it->second.prop,
-                                  it->second.area, it->first.c_str());
-                        } else {
-                            ALOGE("Unable to update property %d area= %d|%s", it->second.prop,
-                                  it->second.area, it->first.c_str());
-                        }
-                    }
-                } else {
-                    ALOGE("Unable to read current value for prop 0x%x area 0x%x from store",
-                          it->second.prop, it->second.area);
+        if (id == VisNameIndex<VisPropertyMapping>::kInvalidId) {
+            ALOGV("Vis parameter name %s is not mapped to any vehicle property",
+                  item.first.c_str());
+        }
+    }
+}
+
+bool VisVehicleHal::refreshFromVis(const std::string& path) {
+    epam::WMessageResult sr;
+    epam::Status st = mVisClient.getPropertySync(path, sr);
+    if (st != epam::Status::OK) {
+        ALOGE("Unable to get %s from VIS", path.c_str());
+        return false;
+    }
+    applyVisValues(sr.commandResult);
+    {
+        std::lock_guard<std::mutex> g(mResyncLock);
+        mPathRefreshTimes[path] = elapsedRealtimeNano();
+    }
+    return true;
+}
+
+bool VisVehicleHal::isRecentlyRefreshed(const std::string& path) {
+    std::lock_guard<std::mutex> g(mResyncLock);
+    auto it = mPathRefreshTimes.find(path);
+    return it != mPathRefreshTimes.end() &&
+           elapsedRealtimeNano() - it->second < kMaxUnsubscribedValueAge.count();
+}
+
+void VisVehicleHal::requestRefresh(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> g(mResyncLock);
+        mRefreshPaths.insert(path);
+    }
+    mResyncCond.notify_one();
+}
+
+void VisVehicleHal::requestResync() {
+    {
+        std::lock_guard<std::mutex> g(mResyncLock);
+        mResyncRequested = true;
+    }
+    mResyncCond.notify_one();
+}
+
+void VisVehicleHal::requestSnapshot() {
+    if (mSnapshotPath.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> g(mResyncLock);
+        mSnapshotRequested = true;
+    }
+    mResyncCond.notify_one();
+}
+
+void VisVehicleHal::resyncLoop() {
+    if (!mSnapshotPath.empty()) {
+        loadSnapshot();
+        StartupTimeline::instance()->mark("snapshot-loaded");
+    }
+
+    std::unique_lock<std::mutex> g(mResyncLock);
+    while (true) {
+        auto wakeUp = [this] {
+            return mResyncRequested || mSnapshotRequested || mSubscriptionSyncRequested ||
+                   !mRefreshPaths.empty() || mResyncExit;
+        };
+        if (mRetryPaths.empty()) {
+            mResyncCond.wait(g, wakeUp);
+        } else {
+            mResyncCond.wait_until(g, mRetryTime, wakeUp);
+        }
+        if (mResyncExit) {
+            g.unlock();
+            if (!mSnapshotPath.empty()) {
+                // Last known values of a service stopped on shutdown.
+                saveSnapshot();
+            }
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        std::set<std::string> retryPaths;
+        if (!mRetryPaths.empty() && now >= mRetryTime) {
+            retryPaths.swap(mRetryPaths);
+        }
+        bool resyncRequested = mResyncRequested;
+        mResyncRequested = false;
+        bool snapshotRequested = mSnapshotRequested;
+        mSnapshotRequested = false;
+        bool subscriptionSyncRequested = mSubscriptionSyncRequested;
+        if (mValuesAreDirty) {
+            // Dirty values mean VIS is not connected, all paths are subscribed on resync.
+            mSubscriptionSyncRequested = false;
+            mResubscribeRequested = false;
+            subscriptionSyncRequested = false;
+        }
+        std::set<std::string> paths;
+        paths.swap(mRefreshPaths);
+        g.unlock();
+        if (snapshotRequested) {
+            saveSnapshot();
+        }
+        if (resyncRequested) {
+            resync();
+        }
+        if (subscriptionSyncRequested) {
+            syncSubscriptions(false);
+        }
+        // Paths are fetched on resync after reconnect, no need to retry them meanwhile.
+        bool connected = mVisClient.getConnectedState() == epam::ConnState::STATE_CONNECTED;
+        if (connected) {
+            for (const auto& path : paths) {
+                refreshFromVis(path);
+            }
+        }
+        std::set<std::string> failedPaths;
+        for (const auto& path : retryPaths) {
+            if (connected && !refreshFromVis(path)) {
+                failedPaths.insert(path);
+            }
+        }
+        g.lock();
+        if (!retryPaths.empty() && !failedPaths.empty()) {
+            mRetryPaths.insert(failedPaths.begin(), failedPaths.end());
+            mRetryBackoff = std::min<std::chrono::nanoseconds>(mRetryBackoff * 2,
+                                                               kMaxRetryBackoff);
+            mRetryTime = std::chrono::steady_clock::now() + mRetryBackoff;
+        }
+    }
+}
+
+void VisVehicleHal::resync() {
+    if (!mValuesAreDirty ||
+        mVisClient.getConnectedState() != epam::ConnState::STATE_CONNECTED) {
+        // Will be requested again on connection.
+        return;
+    }
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        generation = mConnectionGeneration;
+    }
+    replayOfflineWrites();
+
+    auto mappings = getMappings();
+    ALOGI("Refreshing %zu mapped VIS paths", mappings->nameIndex.size());
+
+    // Fetch mapped paths only, split into chunks fetched in parallel.
+    size_t pathCount = mappings->nameIndex.size();
+    size_t workerCount = std::min(getResyncWorkers(), std::max<size_t>(pathCount, 1));
+    std::vector<std::future<std::vector<std::string>>> workers;
+    for (size_t w = 0; w < workerCount; w++) {
+        workers.push_back(std::async(std::launch::async, [this, &mappings, w, workerCount, pathCount] {
+            std::vector<std::string> failed;
+            for (size_t id = w; id < pathCount; id += workerCount) {
+                const std::string& path = mappings->nameIndex.getName(id);
+                if (!refreshFromVis(path)) {
+                    failed.push_back(path);
                 }
-            } else {
-                ALOGV("Vis parameter name %s is not mapped to any vehicle property",
-                      item.first.c_str());
             }
+            return failed;
+        }));
+    }
+    std::set<std::string> failedPaths;
+    for (auto& worker : workers) {
+        auto failed = worker.get();
+        failedPaths.insert(failed.begin(), failed.end());
+    }
+    {
+        // A path unknown to VIS must not keep the rest of values dirty and unsubscribed.
+        std::lock_guard<std::mutex> g(mResyncLock);
+        mRetryPaths = failedPaths;
+        mRetryBackoff = kMinRetryBackoff;
+        mRetryTime = std::chrono::steady_clock::now() + mRetryBackoff;
+    }
+    if (!failedPaths.empty()) {
+        ALOGW("Failed to refresh %zu of %zu VIS paths, will retry them", failedPaths.size(),
+              pathCount);
+    }
+    StartupTimeline::instance()->mark("vis-values-fetched");
+
+    syncSubscriptions(true);
+    StartupTimeline::instance()->mark("vis-subscribed");
+
+    std::lock_guard<std::mutex> lock(mLock);
+    // Values fetched before a disconnect are still dirty.
+    if (generation != mConnectionGeneration) {
+        return;
+    }
+    if (getMappings() != mappings) {
+        // Reloaded mappings are not refreshed while values are dirty, fetch them as well.
+        requestResync();
+        return;
+    }
+    mValuesAreDirty = false;
+    mSnapshotValid = true;
+    ALOGI("VIS values are refreshed");
+    StartupTimeline::instance()->mark("vis-synced");
+}
+
+void VisVehicleHal::replayOfflineWrites() {
+    std::vector<std::pair<std::string, VisWrite>> writes;
+    {
+        std::lock_guard<std::mutex> g(mWriteLock);
+        mWritesOffline = false;
+        for (auto& it : mOfflineWrites) {
+            if (mWritesInFlight.count(it.first) > 0) {
+                // A write sent before the disconnect hasn't completed yet, the queued one is
+                // sent after it.
+                mPendingWrites[it.first] = std::move(it.second);
+                continue;
+            }
+            // Held in flight, so newer sets of the paths are written after the replayed ones.
+            mWritesInFlight.insert(it.first);
+            writes.emplace_back(it.first, std::move(it.second));
+        }
+        mOfflineWrites.clear();
+    }
+    if (writes.empty()) {
+        return;
+    }
+    ALOGI("Replaying %zu writes queued while VIS was unreachable", writes.size());
+    // Written one by one before values are fetched, the fetch then returns VIS values for
+    // the rejected ones.
+    std::vector<bool> accepted;
+    for (auto& write : writes) {
+        accepted.push_back(writeToVis({write}, 0)[0]);
+    }
+
+    std::vector<VisWrite> failed;
+    {
+        std::lock_guard<std::mutex> g(mWriteLock);
+        for (size_t i = 0; i < writes.size(); i++) {
+            completeWrite(writes[i].first, std::move(writes[i].second), accepted[i], &failed);
+        }
+    }
+    reportFailedWrites(failed);
+}
+
+bool VisVehicleHal::requeuePendingWrite(const std::string& path,
+                                        std::vector<VisWrite>* failed) {
+    auto pending = mPendingWrites.find(path);
+    if (pending == mPendingWrites.end()) {
+        return false;
+    }
+    if (mWritesOffline) {
+        queueOfflineWrite(path, std::move(pending->second), failed);
+        mPendingWrites.erase(pending);
+    } else {
+        mReadyWritePaths.push_back(path);
+        mWriteCond.notify_one();
+    }
+    return true;
+}
+
+void VisVehicleHal::loadSnapshot() {
+    std::ifstream file(mSnapshotPath);
+    if (!file.is_open()) {
+        return;
+    }
+    Json::Value root;
+    Json::Reader reader;
+    if (!reader.parse(file, root, false) || !root.isArray()) {
+        ALOGE("Unable to parse last known values %s", mSnapshotPath.c_str());
+        return;
+    }
+    int64_t timestamp = elapsedRealtimeNano();
+    for (unsigned int i = 0; i < root.size(); i++) {
+        const Json::Value& val = root[i];
+        VehicleAreaProperty prop = {
+            .prop = val["prop"].asInt(),
+            .area = val["area"].asInt(),
+        };
+        VisPropertyMapping mapping = {prop, getJsonConverter(getPropType(prop.prop)), false};
+        updateFromVis(mapping, val["value"], timestamp, nullptr);
+    }
+    ALOGI("Loaded %u last known values from %s", root.size(), mSnapshotPath.c_str());
+}
+
+void VisVehicleHal::saveSnapshot() {
+    // Defaults and values loaded on start are not worth persisting.
+    if (!mSnapshotValid) {
+        return;
+    }
+    auto mappings = getMappings();
+    std::string snapshot = "[";
+    std::string visValue;
+    for (const auto& it : mappings->propertyToVisName) {
+        auto value = mPropStore->readValueOrNull(it.first.prop, it.first.area);
+        if (value == nullptr) {
+            continue;
+        }
+        bool isString = getPropType(value->prop) == VehiclePropertyType::STRING;
+        vehiclePropValueToVisString(*value, &visValue);
+        if (visValue.empty() && !isString) {
+            // Not representable in VIS.
+            continue;
+        }
+        if (snapshot.size() > 1) {
+            snapshot += ",";
+        }
+        snapshot += "\n{\"prop\":";
+        snapshot += std::to_string(it.first.prop);
+        snapshot += ",\"area\":";
+        snapshot += std::to_string(it.first.area);
+        snapshot += ",\"value\":";
+        snapshot += isString ? Json::valueToQuotedString(visValue.c_str()) : visValue;
+        snapshot += '}';
+    }
+    snapshot += "\n]\n";
+    if (snapshot == mLastSnapshot) {
+        return;
+    }
+
+    // Written aside and renamed, so a snapshot is either complete or missing.
+    std::string tmpPath = mSnapshotPath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        out << snapshot;
+        if (!out.good()) {
+            ALOGW("Unable to write last known values %s", tmpPath.c_str());
+            unlink(tmpPath.c_str());
+            return;
+        }
+    }
+    if (rename(tmpPath.c_str(), mSnapshotPath.c_str()) != 0) {
+        ALOGW("Unable to write last known values %s", mSnapshotPath.c_str());
+        unlink(tmpPath.c_str());
+        return;
+    }
+    mLastSnapshot.swap(snapshot);
+}
+
+bool VisVehicleHal::isOfflineQueueFull(const std::string& path) {
+    std::lock_guard<std::mutex> g(mWriteLock);
+    return mWritesOffline && mOfflineWrites.size() >= mOfflineQueueSize &&
+           mOfflineWrites.count(path) == 0;
+}
+
+bool VisVehicleHal::enqueueVisWrite(const std::string& path, const VehiclePropValue& value) {
+    // Formatted into a per thread buffer, so replacing a pending value doesn't allocate.
+    thread_local std::string visValue;
+    vehiclePropValueToVisString(value, &visValue);
+    {
+        std::lock_guard<std::mutex> g(mWriteLock);
+        auto& writes = mWritesOffline ? mOfflineWrites : mPendingWrites;
+        auto it = writes.find(path);
+        if (it != writes.end()) {
+            // Not sent yet, only the latest value is written.
+            it->second.prop = value.prop;
+            it->second.areaId = value.areaId;
+            it->second.visValue.assign(visValue);
+            return true;
+        }
+        if (mWritesOffline && mOfflineWrites.size() >= mOfflineQueueSize) {
+            return false;
+        }
+        VisWrite write = {.prop = value.prop,
+                          .areaId = value.areaId,
+                          .visValue = visValue,
+                          .isString = getPropType(value.prop) == VehiclePropertyType::STRING,
+                          .dueTime = elapsedRealtimeNano() + mSetDebounce.count()};
+        writes.emplace(path, std::move(write));
+        if (mWritesOffline || mWritesInFlight.count(path) > 0) {
+            // Replayed on reconnect or sent once the write in flight completes.
+            return true;
+        }
+        mReadyWritePaths.push_back(path);
+    }
+    mWriteCond.notify_one();
+    return true;
+}
+
+void VisVehicleHal::visWriterLoop() {
+    std::unique_lock<std::mutex> g(mWriteLock);
+    while (!mWriterExit) {
+        if (mReadyWritePaths.empty()) {
+            mWriteCond.wait(g);
+            continue;
+        }
+        auto writes = mPendingWrites.find(mReadyWritePaths.front());
+        int64_t now = elapsedRealtimeNano();
+        if (writes->second.dueTime > now) {
+            // Newer values replace the pending one until the debounce window ends.
+            mWriteCond.wait_for(g, std::chrono::nanoseconds(writes->second.dueTime - now));
+            continue;
+        }
+        // Take the due writes to leaves of the same branch as the first one. Strings are sent
+        // alone, so they are always encoded the same way.
+        std::vector<std::pair<std::string, VisWrite>> batch;
+        size_t branchLength = 0;
+        for (auto path = mReadyWritePaths.begin();
+             path != mReadyWritePaths.end() && batch.size() < mSetBatchSize;) {
+            writes = mPendingWrites.find(*path);
+            if (writes->second.dueTime > now) {
+                break;
+            }
+            if (batch.empty()) {
+                branchLength = writes->second.isString ? 0 : getVisBranchLength(*path);
+            } else if (writes->second.isString || getVisBranchLength(*path) != branchLength ||
+                       path->compare(0, branchLength, batch.front().first, 0, branchLength) != 0) {
+                ++path;
+                continue;
+            }
+            mWritesInFlight.insert(*path);
+            batch.emplace_back(std::move(*path), std::move(writes->second));
+            mPendingWrites.erase(writes);
+            path = mReadyWritePaths.erase(path);
+            if (branchLength == 0) {
+                break;
+            }
+        }
+        g.unlock();
+
+        std::vector<bool> accepted = writeToVis(batch, branchLength);
+
+        g.lock();
+        std::vector<VisWrite> failed;
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (completeWrite(batch[i].first, std::move(batch[i].second), accepted[i],
+                              &failed)) {
+                // Replace the optimistically stored value with the one VIS has.
+                requestRefresh(batch[i].first);
+            }
+        }
+        if (!failed.empty()) {
+            g.unlock();
+            reportFailedWrites(failed);
+            g.lock();
+        }
+    }
+}
+
+bool VisVehicleHal::completeWrite(const std::string& path, VisWrite write, bool accepted,
+                                  std::vector<VisWrite>* failed) {
+    mWritesInFlight.erase(path);
+    if (requeuePendingWrite(path, failed) || accepted) {
+        // A newer value of the path is written next.
+        return false;
+    }
+    if (mWritesOffline) {
+        // VIS is lost while the write is in flight, it is replayed on reconnect.
+        queueOfflineWrite(path, std::move(write), failed);
+        return false;
+    }
+    failed->push_back(std::move(write));
+    return true;
+}
+
+void VisVehicleHal::queueOfflineWrite(const std::string& path, VisWrite write,
+                                      std::vector<VisWrite>* failed) {
+    if (mOfflineWrites.count(path) > 0) {
+        // A newer offline set of the path is kept.
+        return;
+    }
+    if (mOfflineWrites.size() >= mOfflineQueueSize) {
+        ALOGW("Offline write queue is full, dropping write of %s", path.c_str());
+        failed->push_back(std::move(write));
+        return;
+    }
+    mOfflineWrites.emplace(path, std::move(write));
+}
+
+void VisVehicleHal::reportFailedWrites(const std::vector<VisWrite>& writes) {
+    for (const auto& write : writes) {
+        doHalPropertySetError(StatusCode::TRY_AGAIN, write.prop, write.areaId);
+    }
+}
+
+std::vector<bool> VisVehicleHal::writeToVis(
+    const std::vector<std::pair<std::string, VisWrite>>& writes, size_t branchLength) {
+    std::vector<bool> accepted(writes.size(), false);
+    if (writes.size() > 1) {
+        std::vector<std::pair<std::string, std::string>> values;
+        values.reserve(writes.size());
+        for (const auto& write : writes) {
+            values.emplace_back(write.first, write.second.visValue);
+        }
+        std::string value = formatVisBranchSet(branchLength, values);
+        std::string branch = writes.front().first.substr(0, branchLength);
+        epam::Status st = mVisClient.setPropertySync(branch, value);
+        if (st == epam::Status::OK) {
+            accepted.assign(writes.size(), true);
+            return accepted;
+        }
+        // The request is rejected as a whole, find out which values are not accepted.
+        ALOGW("SET of %zu values of %s returned != OK [%d], writing them one by one",
+              writes.size(), branch.c_str(), st);
+    }
+    for (size_t i = 0; i < writes.size(); i++) {
+        const std::string& path = writes[i].first;
+        epam::Status st = mVisClient.setPropertySync(path, writes[i].second.visValue);
+        if (st == epam::Status::OK) {
+            accepted[i] = true;
+        } else {
+            ALOGE("SET of %s returned != OK [%d]", path.c_str(), st);
         }
-        subscribeToAll();
-        mValuesAreDirty = false;
-        return true;
     }
-    return false;
+    return accepted;
 }
 
 void VisVehicleHal::initStaticConfig() {
@@ -497,24 +1548,68 @@ void VisVehicleHal::initStaticConfig() {
     }
 }
 
+void VisVehicleHal::applyDeferredUpdates() {
+    auto mappings = getMappings();
+    std::vector<std::pair<int32_t, Json::Value>> updates;
+    std::vector<int64_t> receiveTimes;
+    {
+        std::lock_guard<std::mutex> g(mappings->deferredLock);
+        for (int32_t id : mappings->deferredIds) {
+            if (mappings->deferredTimes[id] != 0) {
+                updates.emplace_back(id, Json::Value());
+                updates.back().second.swap(mappings->deferredValues[id]);
+                receiveTimes.push_back(mappings->deferredTimes[id]);
+                mappings->deferredTimes[id] = 0;
+            }
+        }
+        mappings->deferredIds.clear();
+    }
+    for (size_t i = 0; i < updates.size(); i++) {
+        int32_t id = updates[i].first;
+        int64_t timestamp;
+        const Json::Value& jval =
+            getSampleValue(updates[i].second, receiveTimes[i], true, &timestamp);
+        for (const VisPropertyMapping& mapping : mappings->nameIndex.getValues(id)) {
+            updateFromVis(mapping, jval, timestamp, nullptr);
+        }
+    }
+}
+
 void VisVehicleHal::onContinuousPropertyTimer(const std::vector<int32_t>& properties) {
-    VehiclePropValuePtr v;
+    auto trimIt = std::find(properties.begin(), properties.end(), kPoolTrimCookie);
+    if (trimIt != properties.end()) {
+        size_t released = getValuePool()->trim(mPoolHighWaterMark);
+        if (released > 0) {
+            ALOGV("Released %zu pooled values", released);
+        }
+        if (properties.size() > 1) {
+            std::vector<int32_t> sampled(properties.begin(), trimIt);
+            sampled.insert(sampled.end(), trimIt + 1, properties.end());
+            onContinuousPropertyTimer(sampled);
+        }
+        return;
+    }
+
+    // Rate limited paths are mapped to continuous properties only, the timer samples them.
+    applyDeferredUpdates();
+
     auto& pool = *getValuePool();
+    int64_t timestamp = elapsedRealtimeNano();
+    std::vector<VehiclePropValuePtr> events;
+    events.reserve(properties.size());
 
-    for (int32_t property : properties) {
-        if (isContinuousProperty(property)) {
-            auto internalPropValue = mPropStore->readValueOrNull(property);
-            if (internalPropValue != nullptr) {
-                v = pool.obtain(*internalPropValue);
+    // Every area of the due properties is sampled in one store pass and sent as a single batch.
+    mPropStore->readValuesForProperties(
+        properties, VehiclePropertyChangeMode::CONTINUOUS, [&](const VehiclePropValue& value) {
+            VehiclePropValuePtr v = pool.obtain(value);
+            if (v.get()) {
+                v->timestamp = timestamp;
+                events.push_back(std::move(v));
             }
-        } else {
-            ALOGE("Unexpected onContinuousPropertyTimer for property: 0x%x", property);
-        }
+        });
 
-        if (v.get()) {
-            v->timestamp = elapsedRealtimeNano();
-            doHalEvent(std::move(v));
-        }
+    if (!events.empty()) {
+        doHalEvents(std::move(events));
     }
 }
 
@@ -527,141 +1622,49 @@ bool VisVehicleHal::isContinuousProperty(int32_t propId) const {
     return config->changeMode == VehiclePropertyChangeMode::CONTINUOUS;
 }
 
-bool VisVehicleHal::jsonToVehicle(const Json::Value& jval, struct VehiclePropValue& val) {
-    switch (getPropType(val.prop)) {
-        case VehiclePropertyType::STRING:
-            ALOGV("Converting VehiclePropertyType::STRING");
-            if (!jval.isString()) {
-                ALOGE("Can't convert to STRING vehicle property 0x%x", val.prop);
-                return false;
-            }
-            val.value.stringValue = jval.asString();
-            break;
-        case VehiclePropertyType::FLOAT:
-            ALOGV("Converting VehiclePropertyType::FLOAT");
-            if (!jval.isConvertibleTo(Json::realValue)) {
-                ALOGE("Can't convert to FLOAT vehicle property 0x%x", val.prop);
-                return false;
-            } else {
-                auto v = getValuePool()->obtainFloat(jval.asFloat());
-                val.value = v->value;
-            }
-            break;
-        case VehiclePropertyType::INT32:
-            ALOGV("Converting VehiclePropertyType::INT32");
-            if (!jval.isInt()) {
-                ALOGE("Can't convert to FLOAT vehicle property 0x%x", val.prop);
-                return false;
-            } else {
-                auto v = getValuePool()->obtainInt32(jval.asInt());
-                val.value = v->value;
-            }
-            break;
-        case VehiclePropertyType::INT64:
-            ALOGV("Converting VehiclePropertyType::INT64");
-            if (!jval.isInt64()) {
-                ALOGE("Can't convert to FLOAT vehicle property 0x%x", val.prop);
-                return false;
-            } else {
-                auto v = getValuePool()->obtainInt64(jval.asInt64());
-                val.value = v->value;
-            }
-            break;
-        case VehiclePropertyType::BOOLEAN:
-            ALOGV("Converting VehiclePropertyType::BOOLEAN");
-            if (jval.isBool()) {
-                auto v = getValuePool()->obtainBoolean(jval.asBool());
-                val.value = v->value;
-            } else if (jval.isInt()) {
-                auto v = getValuePool()->obtainBoolean(static_cast<bool>(jval.asInt()));
-                val.value = v->value;
-            } else if (jval.isInt64()) {
-                auto v = getValuePool()->obtainBoolean(static_cast<bool>(jval.asInt64()));
-                val.value = v->value;
-            } else {
-                ALOGE("Can't convert to BOOLEAN vehicle property 0x%x", val.prop);
-                return false;
-            }
-            break;
-        case VehiclePropertyType::INT32_VEC:
-            ALOGD("Converting VehiclePropertyType::INT32_VEC");
-            if (!jval.isArray()) {
-                ALOGE("Can't convert to INT32_VEC vehicle property 0x%x", val.prop);
-                return false;
-            } else {
-                if (jval[0].isInt()) {
-                    for (unsigned int i = 0; i < jval.size(); i++) {
-                        if (val.value.int32Values.size() > i) {
-                            val.value.int32Values[i] = jval[i].asInt();
-                        } else {
-                            ALOGE("Error converting[%d] to INT32_VEC vprop 0x%x size %zu:%u", i,
-                                  val.prop, val.value.int32Values.size(), jval.size());
-                        }
-                    }
-                } else {
-                    ALOGE("Can't convert to INT32_VEC vehicle property 0x%x", val.prop);
-                    return false;
-                }
-            }
-            break;
-        case VehiclePropertyType::INT64_VEC:
-            ALOGD("Converting VehiclePropertyType::INT64_VEC");
-            if (!jval.isArray()) {
-                ALOGE("Can't convert to INT64_VEC vehicle property 0x%x", val.prop);
-                return false;
-            } else {
-                if (jval[0].isInt64()) {
-                    for (unsigned int i = 0; i < jval.size(); i++) {
-                        if (val.value.int64Values.size() > i) {
-                            val.value.int64Values[i] = jval[i].asInt64();
-                        } else {
-                            ALOGE("Error converting[%d] to INT64_VEC vprop 0x%x size %zu:%u", i,
-                                  val.prop, val.value.int64Values.size(), jval.size());
-                        }
-                    }
-                } else {
-                    ALOGE("Can't convert to INT64_VEC vehicle property 0x%x", val.prop);
-                    return false;
-                }
-            }
-            break;
-        case VehiclePropertyType::FLOAT_VEC:
-            ALOGV("Converting VehiclePropertyType::FLOAT_VEC");
-            if (!jval.isArray()) {
-                ALOGE("Can't convert to FLOAT_VEC vehicle property 0x%x", val.prop);
-                return false;
-            } else {
-                if (jval[0].isConvertibleTo(Json::realValue)) {
-                    for (unsigned int i = 0; i < jval.size(); i++) {
-                        if (val.value.floatValues.size() > i) {
-                            val.value.floatValues[i] = jval[i].asFloat();
-                        } else {
-                            ALOGE("Error converting[%d] to FLOAT_VEC vprop 0x%x size %zu:%u", i,
-                                  val.prop, val.value.floatValues.size(), jval.size());
-                        }
-                    }
-                } else {
-                    ALOGE("Can't convert to FLOAT_VEC vehicle property 0x%x", val.prop);
-                    return false;
-                }
-            }
-            break;
-        case VehiclePropertyType::BYTES:
-            ALOGV("Converting VehiclePropertyType::BYTES");
-            ALOGE("Conversion from BYTES is unsupported");
-            return false;
-            break;
-        case VehiclePropertyType::MIXED:
-            ALOGV("Converting VehiclePropertyType::MIXED");
-            ALOGE("Conversion to MIXED is unsupported");
-            return false;
-            break;
-        default:
-            ALOGE("Invalid property type %d", val.prop);
-            return false;
-            break;
+const Json::Value& VisVehicleHal::getSampleValue(const Json::Value& jval, int64_t receiveTime,
+                                                 bool pushed, int64_t* timestamp) {
+    *timestamp = receiveTime;
+    if (!jval.isObject() || !jval.isMember("value") || !jval.isMember("ts")) {
+        return jval;
     }
-    return true;
+    const Json::Value& ts = jval["ts"];
+    int64_t sourceTimeMs;
+    if (ts.isIntegral() || ts.isDouble()) {
+        sourceTimeMs = ts.asInt64();
+    } else if (ts.isString()) {
+        const char* str = ts.asCString();
+        char* end;
+        sourceTimeMs = strtoll(str, &end, 10);
+        if (end == str || *end != '\0') {
+            ALOGW("Invalid VIS timestamp %s", str);
+            return jval["value"];
+        }
+    } else {
+        ALOGW("Invalid VIS timestamp type %d", ts.type());
+        return jval["value"];
+    }
+    *timestamp = mSourceClock.toBootTime(sourceTimeMs * 1000000, receiveTime, pushed);
+    return jval["value"];
+}
+
+bool VisVehicleHal::updateFromVis(const VisPropertyMapping& mapping, const Json::Value& jval,
+                                  int64_t timestamp, VehiclePropValuePtr* event) {
+    const VehicleAreaProperty& prop = mapping.property;
+    bool valid = mapping.convert != nullptr;
+    bool changed = mPropStore->updateValue(
+        prop.prop, prop.area, timestamp,
+        [&mapping, &jval, &valid](VehiclePropValue* value) {
+            bool changed = false;
+            valid = valid && mapping.convert(jval, &value->value, &changed);
+            return changed;
+        },
+        event != nullptr ? getValuePool() : nullptr, event);
+    if (!valid) {
+        ALOGE("Can't convert VIS value to vehicle property 0x%x area 0x%x", prop.prop,
+              prop.area);
+    }
+    return changed;
 }
 
 }  // namespace xenvm
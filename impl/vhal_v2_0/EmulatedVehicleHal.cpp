@@ -268,6 +268,9 @@ void EmulatedVehicleHal::onCreate() {
                 prop.value = it.initialValue;
             }
             mPropStore->writeValue(prop, shouldUpdateStatus);
+            if (i == 0) {
+                getValuePool()->prewarm(cfg, prop.value);
+            }
         }
     }
     initObd2LiveFrame(*mPropStore->getConfigOrDie(OBD2_LIVE_FRAME));
@@ -279,24 +282,23 @@ std::vector<VehiclePropConfig> EmulatedVehicleHal::listProperties()  {
 }
 
 void EmulatedVehicleHal::onContinuousPropertyTimer(const std::vector<int32_t>& properties) {
-    VehiclePropValuePtr v;
-
     auto& pool = *getValuePool();
-
-    for (int32_t property : properties) {
-        if (isContinuousProperty(property)) {
-            auto internalPropValue = mPropStore->readValueOrNull(property);
-            if (internalPropValue != nullptr) {
-                v = pool.obtain(*internalPropValue);
+    int64_t timestamp = elapsedRealtimeNano();
+    std::vector<VehiclePropValuePtr> events;
+    events.reserve(properties.size());
+
+    // Every area of the due properties is sampled in one store pass and sent as a single batch.
+    mPropStore->readValuesForProperties(
+        properties, VehiclePropertyChangeMode::CONTINUOUS, [&](const VehiclePropValue& value) {
+            VehiclePropValuePtr v = pool.obtain(value);
+            if (v.get()) {
+                v->timestamp = timestamp;
+                events.push_back(std::move(v));
             }
-        } else {
-            ALOGE("Unexpected onContinuousPropertyTimer for property: 0x%x", property);
-        }
+        });
 
-        if (v.get()) {
-            v->timestamp = elapsedRealtimeNano();
-            doHalEvent(std::move(v));
-        }
+    if (!events.empty()) {
+        doHalEvents(std::move(events));
     }
 }
 
@@ -317,6 +319,10 @@ StatusCode EmulatedVehicleHal::unsubscribe(int32_t property) {
     return StatusCode::OK;
 }
 
+std::string EmulatedVehicleHal::dump() {
+    return mRecurrentTimer.dumpStats();
+}
+
 bool EmulatedVehicleHal::isContinuousProperty(int32_t propId) const {
     const VehiclePropConfig* config = mPropStore->getConfigOrNull(propId);
     if (config == nullptr) {
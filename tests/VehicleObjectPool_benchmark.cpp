@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vhal_v2_0/VehicleObjectPool.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+
+namespace {
+
+void BM_ValuePoolObtain(benchmark::State& state) {
+    static VehiclePropValuePool pool;
+    for (auto _ : state) {
+        auto value = pool.obtain(VehiclePropertyType::INT32_VEC, state.range(0));
+        benchmark::DoNotOptimize(value.get());
+    }
+}
+BENCHMARK(BM_ValuePoolObtain)->Arg(2)->Arg(64)->ThreadRange(1, 4);
+
+/* Values are obtained by the benchmark thread and recycled by another thread, as VIS updates are
+ * obtained by VisClient threads and recycled by the batching thread. */
+void BM_ValuePoolCrossThread(benchmark::State& state) {
+    VehiclePropValuePool pool;
+    std::mutex lock;
+    std::vector<VehiclePropValuePool::RecyclableType> queue;
+    std::atomic<bool> stop(false);
+    std::thread consumer([&] {
+        std::vector<VehiclePropValuePool::RecyclableType> local;
+        while (!stop) {
+            {
+                std::lock_guard<std::mutex> g(lock);
+                local.swap(queue);
+            }
+            local.clear();
+            std::this_thread::yield();
+        }
+    });
+    for (auto _ : state) {
+        auto value = pool.obtain(VehiclePropertyType::INT32_VEC, 2);
+        std::lock_guard<std::mutex> g(lock);
+        queue.push_back(std::move(value));
+    }
+    stop = true;
+    consumer.join();
+    queue.clear();
+}
+BENCHMARK(BM_ValuePoolCrossThread)->UseRealTime();
+
+}  // namespace
+
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vhal_v2_0/VehicleObjectPool.h"
+#include "vhal_v2_0/VehicleUtils.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+
+namespace {
+
+struct Counted {
+    static std::atomic<int> live;
+
+    Counted() { live++; }
+    ~Counted() { live--; }
+};
+
+std::atomic<int> Counted::live {0};
+
+class CountedPool : public ObjectPool<Counted> {
+public:
+    explicit CountedPool(size_t maxMagazines = 0) : ObjectPool(maxMagazines) {}
+
+    int createdObjects() const { return mCreated; }
+
+protected:
+    Counted* createObject() override {
+        mCreated++;
+        return new Counted();
+    }
+
+private:
+    std::atomic<int> mCreated {0};
+};
+
+/* Obtains count objects and recycles them at once. */
+void obtainAndRecycle(CountedPool* pool, int count) {
+    std::vector<recyclable_ptr<Counted>> objects;
+    for (int i = 0; i < count; i++) {
+        objects.push_back(pool->obtain());
+    }
+}
+
+TEST(VehicleObjectPoolTest, recyclablePtrIsTwoPointers) {
+    EXPECT_EQ(2 * sizeof(void*), sizeof(recyclable_ptr<Counted>));
+}
+
+TEST(VehicleObjectPoolTest, deleterWithoutPoolDeletes) {
+    int liveBefore = Counted::live;
+    {
+        recyclable_ptr<Counted> o(new Counted(), Deleter<Counted>());
+        EXPECT_EQ(liveBefore + 1, Counted::live.load());
+    }
+    EXPECT_EQ(liveBefore, Counted::live.load());
+}
+
+TEST(VehicleObjectPoolTest, recycledObjectIsReused) {
+    CountedPool pool;
+    Counted* raw;
+    {
+        auto o = pool.obtain();
+        raw = o.get();
+    }
+    auto o = pool.obtain();
+    EXPECT_EQ(raw, o.get());
+    EXPECT_EQ(1, pool.createdObjects());
+
+    auto stats = pool.getStats();
+    EXPECT_EQ(2u, stats.obtained);
+    EXPECT_EQ(1u, stats.created);
+    EXPECT_EQ(1u, stats.recycled);
+}
+
+TEST(VehicleObjectPoolTest, objectsReusedBeyondThreadCache) {
+    CountedPool pool;
+    // More objects than the two magazines cached by a thread go through the depot.
+    obtainAndRecycle(&pool, 100);
+    obtainAndRecycle(&pool, 100);
+    EXPECT_EQ(100, pool.createdObjects());
+}
+
+TEST(VehicleObjectPoolTest, depotCapacityReleasesObjects) {
+    CountedPool pool(4);
+    // Two magazines stay in the thread cache, two in the depot, the rest is released.
+    obtainAndRecycle(&pool, 80);
+    auto stats = pool.getStats();
+    EXPECT_EQ(32u, stats.depotObjects);
+    EXPECT_EQ(16u, stats.released);
+
+    obtainAndRecycle(&pool, 80);
+    EXPECT_EQ(96, pool.createdObjects());
+}
+
+TEST(VehicleObjectPoolTest, depotCapacityCountsThreadCaches) {
+    CountedPool pool(4);
+    std::mutex lock;
+    std::condition_variable cond;
+    bool cached = false;
+    bool done = false;
+    std::thread other([&] {
+        obtainAndRecycle(&pool, 32);
+        std::unique_lock<std::mutex> g(lock);
+        cached = true;
+        cond.notify_all();
+        cond.wait(g, [&] { return done; });
+    });
+    {
+        std::unique_lock<std::mutex> g(lock);
+        cond.wait(g, [&] { return cached; });
+    }
+
+    // The other thread caches 32 objects, so the depot has no room for more.
+    obtainAndRecycle(&pool, 80);
+    auto stats = pool.getStats();
+    EXPECT_EQ(0u, stats.depotObjects);
+    EXPECT_EQ(48u, stats.released);
+
+    {
+        std::lock_guard<std::mutex> g(lock);
+        done = true;
+    }
+    cond.notify_all();
+    other.join();
+    // Objects of the exited thread are stored as long as they fit.
+    EXPECT_EQ(32u, pool.getStats().depotObjects);
+}
+
+TEST(VehicleObjectPoolTest, longVectorReusedOnlyWithSameLength) {
+    VehiclePropValuePool pool;
+    VehiclePropValue* raw;
+    const int32_t* data;
+    {
+        auto v = pool.obtain(VehiclePropertyType::INT32_VEC, 100);
+        raw = v.get();
+        data = v->value.int32Values.data();
+    }
+    {
+        auto v = pool.obtain(VehiclePropertyType::INT32_VEC, 100);
+        EXPECT_EQ(raw, v.get());
+        EXPECT_EQ(data, v->value.int32Values.data());
+    }
+    auto v = pool.obtain(VehiclePropertyType::INT32_VEC, 90);
+    EXPECT_NE(raw, v.get());
+    EXPECT_EQ(90u, v->value.int32Values.size());
+}
+
+TEST(VehicleObjectPoolTest, vectorsAboveBoundAreNotPooled) {
+    VehiclePropValuePool pool;
+    const size_t size = VehiclePropValuePool::kMaxBoundedVectorSize + 1;
+    pool.obtain(VehiclePropertyType::FLOAT_VEC, size);
+    EXPECT_EQ(size, pool.obtain(VehiclePropertyType::FLOAT_VEC, size)->value.floatValues.size());
+    EXPECT_EQ(std::string::npos, pool.dump().find("bounded"));
+}
+
+TEST(VehicleObjectPoolTest, prewarmCreatesExactCount) {
+    CountedPool pool;
+    pool.prewarm(5);
+    EXPECT_EQ(5, pool.createdObjects());
+    EXPECT_EQ(5u, pool.getStats().depotObjects);
+
+    // The partial magazine is topped up first.
+    pool.prewarm(20);
+    EXPECT_EQ(25, pool.createdObjects());
+    EXPECT_EQ(25u, pool.getStats().depotObjects);
+
+    obtainAndRecycle(&pool, 25);
+    EXPECT_EQ(0u, pool.getStats().created);
+    EXPECT_EQ(25, pool.createdObjects());
+}
+
+TEST(VehicleObjectPoolTest, trimReleasesWholeMagazinesAbovePrewarmed) {
+    CountedPool pool;
+    pool.prewarm(32);
+    obtainAndRecycle(&pool, 112);
+    // Two magazines stay in the thread cache, the rest is in the depot.
+    ASSERT_EQ(80u, pool.getStats().depotObjects);
+
+    EXPECT_EQ(48u, pool.trim(0));
+    EXPECT_EQ(32u, pool.getStats().depotObjects);
+    EXPECT_EQ(0u, pool.trim(0));
+    EXPECT_EQ(48u, pool.getStats().released);
+}
+
+TEST(VehicleObjectPoolTest, trimKeepsHighWaterMark) {
+    CountedPool pool;
+    obtainAndRecycle(&pool, 96);
+    ASSERT_EQ(64u, pool.getStats().depotObjects);
+    // Only whole magazines are released.
+    EXPECT_EQ(16u, pool.trim(40));
+    EXPECT_EQ(48u, pool.getStats().depotObjects);
+}
+
+TEST(VehicleObjectPoolTest, prewarmValuePerAreaOfContinuousProperty) {
+    VehiclePropValuePool pool;
+    VehiclePropConfig config = {};
+    config.prop = 0x0101 | toInt(VehiclePropertyType::FLOAT) |
+                  toInt(VehiclePropertyGroup::VENDOR) | toInt(VehicleArea::SEAT);
+    config.changeMode = VehiclePropertyChangeMode::CONTINUOUS;
+    config.maxSampleRate = 100;
+    config.areaConfigs.resize(2);
+    VehiclePropValue::RawValue value = {};
+    value.floatValues.resize(1);
+    pool.prewarm(config, value);
+    EXPECT_NE(std::string::npos, pool.dump().find("free in depot 2\n"));
+
+    config.changeMode = VehiclePropertyChangeMode::ON_CHANGE;
+    pool.prewarm(config, value);
+    EXPECT_NE(std::string::npos, pool.dump().find("free in depot 3\n"));
+}
+
+TEST(VehicleObjectPoolTest, objectsPassedBetweenThreads) {
+    constexpr int kProducers = 4;
+    constexpr int kObjectsPerProducer = 10000;
+    CountedPool pool;
+    std::mutex lock;
+    std::vector<recyclable_ptr<Counted>> queue;
+    std::atomic<int> producing {kProducers};
+
+    std::thread consumer([&] {
+        std::vector<recyclable_ptr<Counted>> local;
+        while (producing > 0 || !local.empty()) {
+            local.clear();
+            std::lock_guard<std::mutex> g(lock);
+            local.swap(queue);
+        }
+    });
+    std::vector<std::thread> producers;
+    for (int t = 0; t < kProducers; t++) {
+        producers.emplace_back([&] {
+            for (int i = 0; i < kObjectsPerProducer; i++) {
+                auto o = pool.obtain();
+                std::lock_guard<std::mutex> g(lock);
+                queue.push_back(std::move(o));
+            }
+            producing--;
+        });
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    consumer.join();
+    queue.clear();
+
+    // Objects recycled by the consumer get back to the producers through the depot.
+    EXPECT_LT(pool.createdObjects(), kProducers * kObjectsPerProducer);
+    auto stats = pool.getStats();
+    EXPECT_EQ(static_cast<uint64_t>(kProducers * kObjectsPerProducer), stats.obtained);
+    EXPECT_EQ(stats.obtained, stats.recycled);
+}
+
+TEST(VehicleObjectPoolTest, threadCacheFreedOnThreadExit) {
+    int liveBefore = Counted::live;
+    std::thread([liveBefore] {
+        CountedPool pool;
+        obtainAndRecycle(&pool, 40);
+        EXPECT_EQ(40, Counted::live - liveBefore);
+    }).join();
+    EXPECT_EQ(liveBefore, Counted::live.load());
+}
+
+}  // namespace
+
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "vhal_v2_0/VehicleUtils.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+
+namespace {
+
+TEST(VehicleUtilsTest, disabledPathIsEmpty) {
+    EXPECT_EQ("", toOptionalPath(kDisabledPath));
+    EXPECT_EQ("/data/vendor/vehicle/vis-snapshot.json",
+              toOptionalPath("/data/vendor/vehicle/vis-snapshot.json"));
+    // Only the exact value disables the path.
+    EXPECT_EQ("/data/none", toOptionalPath("/data/none"));
+}
+
+}  // namespace
+
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
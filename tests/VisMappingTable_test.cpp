@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "vhal_v2_0/VisMappingTable.h"
+#include "vhal_v2_0/VisNameIndex.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+namespace {
+
+constexpr uint64_t kStaticHash = 0x1234;
+
+class VisMappingTableTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(android::base::WriteStringToFile("[]", mSource.path));
+        ASSERT_EQ(0, stat(mSource.path, &mSourceStat));
+
+        std::multimap<std::string, int32_t> names = {
+            {"Signal.Cabin.HVAC.Row1.Left.Temperature", 0x101},
+            {"Signal.Cabin.HVAC.Row1.Left.Temperature", 0x102},
+            {"Signal.Vehicle.Speed", 0x103},
+        };
+        VisNameIndex<int32_t> index(names);
+        // Mappings are collected in the name id order, as the table requires.
+        for (size_t id = 0; id < index.size(); id++) {
+            mNames.push_back(index.getName(id));
+            for (int32_t prop : index.getValues(id)) {
+                mMappings.push_back({prop, 0, static_cast<uint32_t>(id)});
+            }
+        }
+        mSeeds = index.getSeeds();
+        ASSERT_TRUE(VisMappingTable::compile(mMappings, mNames, mSeeds, mSourceStat,
+                                             kStaticHash, mTable.path));
+    }
+
+    TemporaryFile mSource;
+    TemporaryFile mTable;
+    struct stat mSourceStat;
+    std::vector<VisMappingTable::Mapping> mMappings;
+    std::vector<std::string> mNames;
+    std::vector<uint32_t> mSeeds;
+};
+
+TEST_F(VisMappingTableTest, loadsCompiledTable) {
+    VisMappingTable table;
+    ASSERT_TRUE(table.load(mTable.path, mSourceStat, kStaticHash));
+    ASSERT_EQ(mMappings.size(), table.size());
+    for (size_t i = 0; i < table.size(); i++) {
+        EXPECT_EQ(mMappings[i].prop, table.getProperty(i));
+        EXPECT_EQ(mMappings[i].nameId, table.getNameId(i));
+    }
+    ASSERT_EQ(mNames.size(), table.getNameCount());
+    for (uint32_t id = 0; id < table.getNameCount(); id++) {
+        EXPECT_EQ(mNames[id], table.getVisName(id));
+        EXPECT_EQ(mSeeds[id], table.getSeed(id));
+    }
+}
+
+TEST_F(VisMappingTableTest, outdatedWithOtherStaticMappings) {
+    VisMappingTable table;
+    EXPECT_FALSE(table.load(mTable.path, mSourceStat, kStaticHash + 1));
+}
+
+TEST_F(VisMappingTableTest, outdatedWithOtherSource) {
+    struct stat source = mSourceStat;
+    source.st_size++;
+    VisMappingTable table;
+    EXPECT_FALSE(table.load(mTable.path, source, kStaticHash));
+}
+
+TEST_F(VisMappingTableTest, rejectsTruncatedTable) {
+    std::string data;
+    ASSERT_TRUE(android::base::ReadFileToString(mTable.path, &data));
+    data.pop_back();
+    ASSERT_TRUE(android::base::WriteStringToFile(data, mTable.path));
+    VisMappingTable table;
+    EXPECT_FALSE(table.load(mTable.path, mSourceStat, kStaticHash));
+}
+
+}  // namespace
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "vhal_v2_0/VisNameIndex.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+namespace {
+
+std::multimap<std::string, int> makeMappings(int count, std::vector<std::string>* names) {
+    std::multimap<std::string, int> mappings;
+    for (int i = 0; i < count; i++) {
+        names->push_back("Signal.Emulator.telemetry.signal" + std::to_string(i));
+        mappings.emplace(names->back(), i);
+    }
+    return mappings;
+}
+
+void BM_NameIndexFind(benchmark::State& state) {
+    std::vector<std::string> names;
+    VisNameIndex<int> index(makeMappings(state.range(0), &names));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(index.find(names[i]));
+        i = (i + 1) % names.size();
+    }
+}
+BENCHMARK(BM_NameIndexFind)->Arg(64)->Arg(4096);
+
+/* The multimap lookup the index replaces. */
+void BM_MultimapFind(benchmark::State& state) {
+    std::vector<std::string> names;
+    auto mappings = makeMappings(state.range(0), &names);
+    size_t i = 0;
+    for (auto _ : state) {
+        auto range = mappings.equal_range(names[i]);
+        benchmark::DoNotOptimize(range.first);
+        i = (i + 1) % names.size();
+    }
+}
+BENCHMARK(BM_MultimapFind)->Arg(64)->Arg(4096);
+
+}  // namespace
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "vhal_v2_0/VisNameIndex.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+namespace {
+
+using Index = VisNameIndex<int>;
+
+std::vector<int> toVector(Index::Span span) {
+    return std::vector<int>(span.begin(), span.end());
+}
+
+TEST(VisNameIndexTest, emptyIndex) {
+    Index index;
+    EXPECT_EQ(0u, index.size());
+    EXPECT_EQ(Index::kInvalidId, index.find("Signal.Cabin.Door.Row1.Left.IsOpen"));
+    EXPECT_TRUE(index.getValues(Index::kInvalidId).empty());
+
+    Index built((std::multimap<std::string, int>()));
+    EXPECT_EQ(Index::kInvalidId, built.find(""));
+}
+
+TEST(VisNameIndexTest, findsEveryName) {
+    std::multimap<std::string, int> mappings;
+    for (int i = 0; i < 2000; i++) {
+        mappings.emplace("Signal.Vehicle.Body.Part" + std::to_string(i) + ".Value", i);
+    }
+    Index index(mappings);
+    ASSERT_EQ(mappings.size(), index.size());
+
+    std::set<int32_t> ids;
+    for (const auto& it : mappings) {
+        int32_t id = index.find(it.first);
+        ASSERT_NE(Index::kInvalidId, id) << it.first;
+        EXPECT_EQ(it.first, index.getName(id));
+        EXPECT_EQ(std::vector<int>({it.second}), toVector(index.getValues(id)));
+        ids.insert(id);
+    }
+    // Ids are dense.
+    EXPECT_EQ(0, *ids.begin());
+    EXPECT_EQ(static_cast<int32_t>(index.size() - 1), *ids.rbegin());
+}
+
+TEST(VisNameIndexTest, groupsValuesOfSameName) {
+    std::multimap<std::string, int> mappings = {
+        {"Signal.Cabin.HVAC.Row1.Left.Temperature", 1},
+        {"Signal.Cabin.HVAC.Row1.Left.Temperature", 2},
+        {"Signal.Vehicle.Speed", 3},
+    };
+    Index index(mappings);
+    EXPECT_EQ(2u, index.size());
+    EXPECT_EQ(std::vector<int>({1, 2}),
+              toVector(index.getValues(index.find("Signal.Cabin.HVAC.Row1.Left.Temperature"))));
+    EXPECT_EQ(std::vector<int>({3}), toVector(index.getValues(index.find("Signal.Vehicle.Speed"))));
+}
+
+TEST(VisNameIndexTest, rebuiltFromPartsWithoutHashing) {
+    std::multimap<std::string, int> mappings = {
+        {"Signal.Cabin.HVAC.Row1.Left.Temperature", 1},
+        {"Signal.Cabin.HVAC.Row1.Left.Temperature", 2},
+        {"Signal.Vehicle.Speed", 3},
+        {"Signal.Vehicle.Acceleration", 4},
+    };
+    Index index(mappings);
+    std::vector<std::string> names;
+    std::vector<uint32_t> offsets;
+    std::vector<int> values;
+    for (size_t id = 0; id < index.size(); id++) {
+        names.push_back(index.getName(id));
+        offsets.push_back(values.size());
+        for (int value : index.getValues(id)) {
+            values.push_back(value);
+        }
+    }
+    offsets.push_back(values.size());
+
+    Index rebuilt(names, index.getSeeds(), offsets, values);
+    for (const auto& it : mappings) {
+        int32_t id = index.find(it.first);
+        EXPECT_EQ(id, rebuilt.find(it.first));
+        EXPECT_EQ(toVector(index.getValues(id)), toVector(rebuilt.getValues(id)));
+    }
+    EXPECT_EQ(Index::kInvalidId, rebuilt.find("Signal.Vehicle.Spee"));
+
+    // Seeds of other names don't place the names at their ids.
+    std::swap(names[0], names[1]);
+    Index mismatched(names, index.getSeeds(), offsets, values);
+    EXPECT_EQ(Index::kInvalidId, mismatched.find(names[0]));
+}
+
+TEST(VisNameIndexTest, rejectsUnknownNames) {
+    std::multimap<std::string, int> mappings = {
+        {"Signal.Vehicle.Speed", 1},
+        {"Signal.Vehicle.Acceleration", 2},
+    };
+    Index index(mappings);
+    EXPECT_EQ(Index::kInvalidId, index.find("Signal.Vehicle.Spee"));
+    EXPECT_EQ(Index::kInvalidId, index.find("Signal.Vehicle.Speed2"));
+    EXPECT_EQ(Index::kInvalidId, index.find(""));
+    EXPECT_TRUE(index.getValues(static_cast<int32_t>(index.size())).empty());
+}
+
+TEST(VisNameIndexTest, findsNameByLength) {
+    std::multimap<std::string, int> mappings = {{"Signal.Vehicle.Speed", 1}};
+    Index index(mappings);
+    // Lookups with an explicit length don't need zero terminated names, e.g. JSON tokens.
+    const char* message = "Signal.Vehicle.Speed\",\"value\":5";
+    EXPECT_NE(Index::kInvalidId, index.find(message, strlen("Signal.Vehicle.Speed")));
+    EXPECT_EQ(Index::kInvalidId, index.find(message, strlen("Signal.Vehicle.Speed\"")));
+}
+
+}  // namespace
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "vhal_v2_0/VisPath.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+namespace {
+
+TEST(VisPathTest, formatBranchSetOfLeaves) {
+    const std::string left = "Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature";
+    EXPECT_EQ(left.rfind('.'), getVisBranchLength(left));
+    EXPECT_EQ(0u, getVisBranchLength("Vehicle"));
+
+    size_t branchLength = getVisBranchLength(left);
+    EXPECT_EQ("[{\"Temperature\":20.5},{\"Fan\":[1,2]}]",
+              formatVisBranchSet(branchLength, {{left, "20.5"},
+                                                {"Actuator.Vehicle.Cabin.HVAC.Row1.Left.Fan",
+                                                 "[1,2]"}}));
+}
+
+}  // namespace
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
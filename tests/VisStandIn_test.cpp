@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+#include <string>
+#include <vector>
+
+#include "VisStandIn.h"
+#include "vhal_v2_0/VisPath.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+namespace {
+
+const char kConfig[] = R"({
+    "Adapters": [
+        {"Plugin": "sensoremulatoradapter.so", "Params": {"UpdatePeriod": 100}},
+        {"Plugin": "storageadapter.so", "Params": {"Data": {
+            "Attribute.Vehicle.VehicleIdentification.VIN": {"Value": "TestVIN"},
+            "Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature": {"Value": 22},
+            "Actuator.Vehicle.Cabin.HVAC.Row1.Left.FanSpeed": {"Value": 1},
+            "Actuator.Vehicle.Cabin.HVAC.Row1.Right.Temperature": {"Value": 20}
+        }}}
+    ]
+})";
+
+const char kSamples[] = R"([
+    {"key": "Test.Vehicle.acc1", "value": "[0.1,0.4,0.0,3]", "ts": "0"},
+    {"key": "Test.Vehicle.name", "value": "text", "ts": "1"}
+])";
+
+Json::Value parse(const std::string& text) {
+    Json::Value jval;
+    EXPECT_TRUE(Json::Reader().parse(text, jval)) << text;
+    return jval;
+}
+
+class VisStandInTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        TemporaryFile config;
+        ASSERT_TRUE(android::base::WriteStringToFile(kConfig, config.path));
+        ASSERT_TRUE(mVis.loadConfig(config.path));
+    }
+
+    /* Sends the request, returns the response to the client. */
+    Json::Value request(VisStandIn::Client client, const std::string& text) {
+        mMessages.clear();
+        mVis.handleMessage(client, text, &mMessages);
+        for (const auto& message : mMessages) {
+            Json::Value jval = parse(message.text);
+            if (message.client == client && jval["action"] != "subscription") {
+                return jval;
+            }
+        }
+        ADD_FAILURE() << "No response to " << text;
+        return Json::Value();
+    }
+
+    /* Returns notifications sent to the client by the last call. */
+    std::vector<Json::Value> notifications(VisStandIn::Client client) {
+        std::vector<Json::Value> result;
+        for (const auto& message : mMessages) {
+            Json::Value jval = parse(message.text);
+            if (message.client == client && jval["action"] == "subscription") {
+                result.push_back(jval);
+            }
+        }
+        return result;
+    }
+
+    VisStandIn mVis;
+    std::vector<VisStandIn::Message> mMessages;
+    const int mClients[2] = {};
+    VisStandIn::Client mClient = &mClients[0];
+    VisStandIn::Client mOtherClient = &mClients[1];
+};
+
+TEST_F(VisStandInTest, getSeededValue) {
+    Json::Value response = request(
+        mClient,
+        R"({"action":"get","path":"Attribute.Vehicle.VehicleIdentification.VIN","requestId":"7"})");
+    EXPECT_EQ("get", response["action"].asString());
+    EXPECT_EQ("7", response["requestId"].asString());
+    EXPECT_EQ("TestVIN",
+              response["value"]["Attribute.Vehicle.VehicleIdentification.VIN"].asString());
+}
+
+TEST_F(VisStandInTest, getBranchAndWildcard) {
+    Json::Value response = request(
+        mClient, R"({"action":"get","path":"Actuator.Vehicle.Cabin.HVAC.Row1","requestId":1})");
+    EXPECT_EQ(3u, response["value"].size());
+
+    response = request(mClient, R"({"action":"get","path":"*","requestId":2})");
+    EXPECT_EQ(4u, response["value"].size());
+}
+
+TEST_F(VisStandInTest, getUnknownPathFails) {
+    Json::Value response = request(
+        mClient, R"({"action":"get","path":"Actuator.Vehicle.Cabin.HVAC.Row","requestId":1})");
+    EXPECT_EQ(404, response["error"]["number"].asInt());
+}
+
+TEST_F(VisStandInTest, setScalarAndBranch) {
+    Json::Value response = request(
+        mClient,
+        R"({"action":"set","path":"Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature",)"
+        R"("value":"25","requestId":1})");
+    EXPECT_FALSE(response.isMember("error"));
+    EXPECT_EQ(25, mVis.getValue("Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature").asInt());
+
+    response = request(
+        mClient,
+        R"({"action":"set","path":"Actuator.Vehicle.Cabin.HVAC.Row1",)"
+        R"("value":"[{\"Left.Temperature\":18},{\"Right.Temperature\":19}]","requestId":2})");
+    EXPECT_FALSE(response.isMember("error"));
+    EXPECT_EQ(18, mVis.getValue("Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature").asInt());
+    EXPECT_EQ(19, mVis.getValue("Actuator.Vehicle.Cabin.HVAC.Row1.Right.Temperature").asInt());
+}
+
+TEST_F(VisStandInTest, setUnknownPathChangesNothing) {
+    Json::Value response = request(
+        mClient,
+        R"({"action":"set","path":"Actuator.Vehicle.Cabin.HVAC.Row1",)"
+        R"("value":[{"Left.Temperature":18},{"Middle.Temperature":19}],"requestId":1})");
+    EXPECT_EQ(404, response["error"]["number"].asInt());
+    EXPECT_EQ(22, mVis.getValue("Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature").asInt());
+}
+
+TEST_F(VisStandInTest, subscribersAreNotified) {
+    Json::Value response = request(
+        mClient, R"({"action":"subscribe","path":"Actuator.Vehicle.Cabin","requestId":1})");
+    std::string subscriptionId = response["subscriptionId"].asString();
+    EXPECT_FALSE(subscriptionId.empty());
+    request(mOtherClient, R"({"action":"subscribe","path":"*","requestId":1})");
+    EXPECT_TRUE(mVis.isSubscribed("Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature"));
+
+    // Values set by a client are pushed to every subscriber, including the client itself.
+    request(mClient,
+            R"({"action":"set","path":"Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature",)"
+            R"("value":30,"requestId":2})");
+    auto pushed = notifications(mClient);
+    ASSERT_EQ(1u, pushed.size());
+    EXPECT_EQ(subscriptionId, pushed[0]["subscriptionId"].asString());
+    EXPECT_EQ(30, pushed[0]["value"]["Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature"].asInt());
+    EXPECT_EQ(1u, notifications(mOtherClient).size());
+
+    mMessages.clear();
+    mVis.publish("Attribute.Vehicle.VehicleIdentification.VIN", Json::Value("OtherVIN"),
+                 &mMessages);
+    EXPECT_TRUE(notifications(mClient).empty());
+    EXPECT_EQ(1u, notifications(mOtherClient).size());
+}
+
+TEST_F(VisStandInTest, unsubscribeAllAndRemoveClient) {
+    request(mClient, R"({"action":"subscribe","path":"*","requestId":1})");
+    request(mClient, R"({"action":"unsubscribeAll","requestId":2})");
+    EXPECT_FALSE(mVis.isSubscribed("Attribute.Vehicle.VehicleIdentification.VIN"));
+
+    request(mOtherClient, R"({"action":"subscribe","path":"*","requestId":1})");
+    mVis.removeClient(mOtherClient);
+    mMessages.clear();
+    mVis.publish("Attribute.Vehicle.VehicleIdentification.VIN", Json::Value("OtherVIN"),
+                 &mMessages);
+    EXPECT_TRUE(mMessages.empty());
+}
+
+/* Returns a set request as sent by VisClient, which sends values as strings. */
+std::string makeSet(const std::string& path, const std::string& value) {
+    Json::Value set;
+    set["action"] = "set";
+    set["path"] = path;
+    set["value"] = value;
+    set["requestId"] = 1;
+    return Json::FastWriter().write(set);
+}
+
+TEST_F(VisStandInTest, batchedSetOfBranchLeaves) {
+    // Sent the way VisVehicleHal sends writes to leaves of one branch due at the same time.
+    const std::string temperature = "Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature";
+    const std::string fanSpeed = "Actuator.Vehicle.Cabin.HVAC.Row1.Left.FanSpeed";
+    size_t branchLength = getVisBranchLength(temperature);
+    ASSERT_EQ(branchLength, getVisBranchLength(fanSpeed));
+    std::string value = formatVisBranchSet(branchLength, {{temperature, "18"}, {fanSpeed, "3"}});
+
+    Json::Value response = request(mClient, makeSet(temperature.substr(0, branchLength), value));
+    EXPECT_FALSE(response.isMember("error"));
+    EXPECT_EQ(18, mVis.getValue(temperature).asInt());
+    EXPECT_EQ(3, mVis.getValue(fanSpeed).asInt());
+}
+
+TEST_F(VisStandInTest, rejectedBatchIsWrittenOneByOne) {
+    const std::string temperature = "Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature";
+    const std::string unknown = "Actuator.Vehicle.Cabin.HVAC.Row1.Left.Unknown";
+    size_t branchLength = getVisBranchLength(temperature);
+    std::string value = formatVisBranchSet(branchLength, {{temperature, "18"}, {unknown, "1"}});
+
+    // The whole request is rejected, no value is changed.
+    Json::Value response = request(mClient, makeSet(temperature.substr(0, branchLength), value));
+    EXPECT_EQ(404, response["error"]["number"].asInt());
+    EXPECT_EQ(22, mVis.getValue(temperature).asInt());
+
+    // Single writes find out which value VIS doesn't accept.
+    EXPECT_FALSE(request(mClient, makeSet(temperature, "18")).isMember("error"));
+    EXPECT_EQ(18, mVis.getValue(temperature).asInt());
+    EXPECT_EQ(404, request(mClient, makeSet(unknown, "1"))["error"]["number"].asInt());
+}
+
+TEST_F(VisStandInTest, stringIsWrittenUnquoted) {
+    // Strings are never batched, they are sent as formatted by vehiclePropValueToVisString().
+    const std::string vin = "Attribute.Vehicle.VehicleIdentification.VIN";
+    EXPECT_FALSE(request(mClient, makeSet(vin, "Other VIN")).isMember("error"));
+    EXPECT_EQ("Other VIN", mVis.getValue(vin).asString());
+}
+
+TEST(VisStandInSamplesTest, loadSamplesDecodesValues) {
+    TemporaryFile data;
+    ASSERT_TRUE(android::base::WriteStringToFile(kSamples, data.path));
+    std::vector<VisStandIn::Sample> samples;
+    ASSERT_TRUE(VisStandIn::loadSamples(data.path, &samples));
+    ASSERT_EQ(2u, samples.size());
+    EXPECT_EQ("Test.Vehicle.acc1", samples[0].path);
+    ASSERT_TRUE(samples[0].value.isArray());
+    EXPECT_EQ(4u, samples[0].value.size());
+    EXPECT_EQ("text", samples[1].value.asString());
+}
+
+}  // namespace
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
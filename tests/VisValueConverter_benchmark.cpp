@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+#include <json/json.h>
+
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "vhal_v2_0/VehicleUtils.h"
+#include "vhal_v2_0/VisNameIndex.h"
+#include "vhal_v2_0/VisValueConverter.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+namespace {
+
+VehiclePropValue makeValue(VehiclePropertyType type, size_t size) {
+    VehiclePropValue value = {};
+    value.prop = 0x0101 | toInt(type) | toInt(VehiclePropertyGroup::VENDOR) |
+                 toInt(VehicleArea::GLOBAL);
+    value.value.int32Values.resize(size);
+    value.value.int64Values.resize(size);
+    value.value.floatValues.resize(size);
+    for (size_t i = 0; i < size; i++) {
+        value.value.int32Values[i] = static_cast<int32_t>(i * 7919);
+        value.value.int64Values[i] = static_cast<int64_t>(i) << 40;
+        value.value.floatValues[i] = 0.1f * i;
+    }
+    return value;
+}
+
+void BM_FormatValue(benchmark::State& state, VehiclePropertyType type, size_t size) {
+    VehiclePropValue value = makeValue(type, size);
+    std::string out;
+    for (auto _ : state) {
+        vehiclePropValueToVisString(value, &out);
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+BENCHMARK_CAPTURE(BM_FormatValue, Int32, VehiclePropertyType::INT32, 1);
+BENCHMARK_CAPTURE(BM_FormatValue, Float, VehiclePropertyType::FLOAT, 1);
+BENCHMARK_CAPTURE(BM_FormatValue, Int64Vec, VehiclePropertyType::INT64_VEC, 8);
+BENCHMARK_CAPTURE(BM_FormatValue, FloatVec, VehiclePropertyType::FLOAT_VEC, 8);
+
+void BM_ConvertValue(benchmark::State& state, VehiclePropertyType type, size_t size) {
+    VehiclePropValue value = makeValue(type, size);
+    std::string str;
+    vehiclePropValueToVisString(value, &str);
+    Json::Value jval;
+    Json::Reader().parse(str, jval);
+    JsonConverter convert = getJsonConverter(type);
+    bool changed = false;
+    for (auto _ : state) {
+        // Alternate between two values, so every conversion writes.
+        value.value.int32Values[0] ^= 1;
+        value.value.int64Values[0] ^= 1;
+        value.value.floatValues[0] += 1;
+        convert(jval, &value.value, &changed);
+        benchmark::DoNotOptimize(changed);
+    }
+}
+BENCHMARK_CAPTURE(BM_ConvertValue, Int32, VehiclePropertyType::INT32, 1);
+BENCHMARK_CAPTURE(BM_ConvertValue, Float, VehiclePropertyType::FLOAT, 1);
+BENCHMARK_CAPTURE(BM_ConvertValue, Int64Vec, VehiclePropertyType::INT64_VEC, 8);
+BENCHMARK_CAPTURE(BM_ConvertValue, FloatVec, VehiclePropertyType::FLOAT_VEC, 8);
+
+/* Signals of a subscription notification, as pushed by the VIS server for cfg/visconfig.json and
+ * cfg/visdata.json. Sensor samples carry their source time. */
+struct Signal {
+    const char* path;
+    VehiclePropertyType type;
+    const char* value;
+};
+
+const Signal kSignals[] = {
+    {"Signal.Emulator.telemetry.veh_speed", VehiclePropertyType::FLOAT,
+     "{\"value\":87.25,\"ts\":1571390000123}"},
+    {"Signal.Emulator.telemetry.engrpml", VehiclePropertyType::FLOAT,
+     "{\"value\":2315.5,\"ts\":1571390000123}"},
+    {"Signal.Emulator.telemetry.avgfuellvl", VehiclePropertyType::FLOAT, "41.7"},
+    {"Signal.Emulator.telemetry.odo", VehiclePropertyType::FLOAT, "120345.8"},
+    {"Signal.Emulator.telemetry.gr", VehiclePropertyType::INT32, "4"},
+    {"Test.Vehicle.acc1", VehiclePropertyType::FLOAT_VEC,
+     "{\"value\":[0.7,0.6,0.1,3],\"ts\":1571390000120}"},
+    {"Test.Vehicle.hvac.fan_speed", VehiclePropertyType::INT32, "2"},
+    {"Actuator.Vehicle.Cabin.HVAC.Row1.FanSpeed", VehiclePropertyType::INT32, "6"},
+    {"Actuator.Vehicle.Cabin.HVAC.Row1.FanDirection", VehiclePropertyType::INT32, "0"},
+    {"Actuator.Vehicle.Cabin.HVAC.Row1.Right.Temperature", VehiclePropertyType::FLOAT, "20"},
+    {"Actuator.Vehicle.Cabin.HVAC.Row1.Left.Temperature", VehiclePropertyType::FLOAT, "22.5"},
+    {"Actuator.Vehicle.Cabin.HVAC.IsFrontDefrosterActive", VehiclePropertyType::BOOLEAN, "false"},
+    {"Actuator.Vehicle.Cabin.HVAC.IsRearDefrosterActive", VehiclePropertyType::BOOLEAN, "true"},
+    {"Attribute.Vehicle.Drivetrain.Transmission.CurrentGear", VehiclePropertyType::INT32, "4"},
+    {"Attribute.Vehicle.Drivetrain.FuelSystem.TankCapacity", VehiclePropertyType::INT32, "15000"},
+    {"Attribute.Vehicle.VehicleIdentification.Brand", VehiclePropertyType::STRING,
+     "\"VIS-based-maker\""},
+};
+
+struct SignalMapping {
+    JsonConverter convert;
+    VehiclePropValue* value;
+};
+
+/* Decodes a whole notification from its text as received on the WebSocket: the message is
+ * parsed, every signal is looked up by name, unwrapped from its sample and converted into the
+ * value of the mapped property. */
+void BM_DecodeSubscription(benchmark::State& state) {
+    std::vector<VehiclePropValue> values(std::size(kSignals));
+    std::multimap<std::string, SignalMapping> mappings;
+    std::string message = "{\"action\":\"subscription\",\"subscriptionId\":\"1\",\"value\":{";
+    for (size_t i = 0; i < std::size(kSignals); i++) {
+        const Signal& signal = kSignals[i];
+        values[i] = makeValue(signal.type, signal.type == VehiclePropertyType::FLOAT_VEC ? 4 : 1);
+        mappings.emplace(signal.path, SignalMapping{getJsonConverter(signal.type), &values[i]});
+        message += std::string(i > 0 ? "," : "") + "\"" + signal.path + "\":" + signal.value;
+    }
+    message += "},\"timestamp\":1571390000125}";
+    VisNameIndex<SignalMapping> index(mappings);
+
+    Json::Reader reader;
+    size_t updated = 0;
+    for (auto _ : state) {
+        Json::Value root;
+        reader.parse(message, root);
+        const Json::Value& signals = root["value"];
+        for (auto it = signals.begin(); it != signals.end(); ++it) {
+            const char* end;
+            const char* name = it.memberName(&end);
+            int32_t id = index.find(name, end - name);
+            const Json::Value& sample = *it;
+            const Json::Value& jval =
+                sample.isObject() && sample.isMember("value") ? sample["value"] : sample;
+            for (const SignalMapping& mapping : index.getValues(id)) {
+                bool changed = false;
+                if (mapping.convert != nullptr) {
+                    mapping.convert(jval, &mapping.value->value, &changed);
+                }
+                updated += changed;
+            }
+        }
+    }
+    benchmark::DoNotOptimize(updated);
+    state.SetItemsProcessed(state.iterations() * std::size(kSignals));
+}
+BENCHMARK(BM_DecodeSubscription);
+
+}  // namespace
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
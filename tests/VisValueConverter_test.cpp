@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "vhal_v2_0/VehicleUtils.h"
+#include "vhal_v2_0/VisValueConverter.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+namespace {
+
+int32_t makeProp(VehiclePropertyType type) {
+    return 0x0101 | toInt(type) | toInt(VehiclePropertyGroup::VENDOR) | toInt(VehicleArea::GLOBAL);
+}
+
+VehiclePropValue makeValue(VehiclePropertyType type) {
+    VehiclePropValue value = {};
+    value.prop = makeProp(type);
+    return value;
+}
+
+Json::Value parse(const std::string& str) {
+    Json::Value jval;
+    Json::Reader reader;
+    EXPECT_TRUE(reader.parse(str, jval)) << str;
+    return jval;
+}
+
+/* Formats the value, parses it back into a value of the same shape and returns the result. */
+VehiclePropValue roundTrip(const VehiclePropValue& value) {
+    std::string str;
+    vehiclePropValueToVisString(value, &str);
+    VehiclePropertyType type = getPropType(value.prop);
+    Json::Value jval = type == VehiclePropertyType::STRING ? Json::Value(str) : parse(str);
+
+    VehiclePropValue result = makeValue(type);
+    result.value.int32Values.resize(value.value.int32Values.size());
+    result.value.int64Values.resize(value.value.int64Values.size());
+    result.value.floatValues.resize(value.value.floatValues.size());
+    bool changed = false;
+    JsonConverter convert = getJsonConverter(type);
+    EXPECT_NE(nullptr, convert);
+    EXPECT_TRUE(convert(jval, &result.value, &changed)) << str;
+    return result;
+}
+
+TEST(VisValueConverterTest, formatScalars) {
+    std::string str;
+    auto value = makeValue(VehiclePropertyType::INT32);
+    value.value.int32Values = hidl_vec<int32_t>{-42};
+    vehiclePropValueToVisString(value, &str);
+    EXPECT_EQ("-42", str);
+
+    value = makeValue(VehiclePropertyType::INT64);
+    value.value.int64Values = hidl_vec<int64_t>{std::numeric_limits<int64_t>::min()};
+    vehiclePropValueToVisString(value, &str);
+    EXPECT_EQ("-9223372036854775808", str);
+
+    value = makeValue(VehiclePropertyType::BOOLEAN);
+    value.value.int32Values = hidl_vec<int32_t>{1};
+    vehiclePropValueToVisString(value, &str);
+    EXPECT_EQ("1", str);
+
+    value = makeValue(VehiclePropertyType::FLOAT);
+    value.value.floatValues = hidl_vec<float>{0.1f};
+    vehiclePropValueToVisString(value, &str);
+    EXPECT_EQ("0.1", str);
+
+    value = makeValue(VehiclePropertyType::STRING);
+    value.value.stringValue = "VIN 123";
+    vehiclePropValueToVisString(value, &str);
+    EXPECT_EQ("VIN 123", str);
+}
+
+TEST(VisValueConverterTest, formatArrays) {
+    std::string str;
+    auto value = makeValue(VehiclePropertyType::INT32_VEC);
+    value.value.int32Values = hidl_vec<int32_t>{1, -2, 3};
+    vehiclePropValueToVisString(value, &str);
+    EXPECT_EQ("[1,-2,3]", str);
+
+    value = makeValue(VehiclePropertyType::FLOAT_VEC);
+    value.value.floatValues = hidl_vec<float>{};
+    vehiclePropValueToVisString(value, &str);
+    EXPECT_EQ("[]", str);
+}
+
+TEST(VisValueConverterTest, formatUnsupportedLeavesEmpty) {
+    std::string str = "previous";
+    auto value = makeValue(VehiclePropertyType::BYTES);
+    value.value.bytes = hidl_vec<uint8_t>{1, 2};
+    vehiclePropValueToVisString(value, &str);
+    EXPECT_TRUE(str.empty());
+
+    str = "previous";
+    vehiclePropValueToVisString(makeValue(VehiclePropertyType::MIXED), &str);
+    EXPECT_TRUE(str.empty());
+}
+
+TEST(VisValueConverterTest, roundTripScalars) {
+    auto value = makeValue(VehiclePropertyType::INT32);
+    value.value.int32Values = hidl_vec<int32_t>{std::numeric_limits<int32_t>::min()};
+    EXPECT_EQ(value.value.int32Values, roundTrip(value).value.int32Values);
+
+    value = makeValue(VehiclePropertyType::INT64);
+    value.value.int64Values = hidl_vec<int64_t>{std::numeric_limits<int64_t>::max()};
+    EXPECT_EQ(value.value.int64Values, roundTrip(value).value.int64Values);
+
+    value = makeValue(VehiclePropertyType::BOOLEAN);
+    value.value.int32Values = hidl_vec<int32_t>{1};
+    EXPECT_EQ(value.value.int32Values, roundTrip(value).value.int32Values);
+
+    value = makeValue(VehiclePropertyType::STRING);
+    value.value.stringValue = "with \"quotes\"";
+    EXPECT_EQ(std::string(value.value.stringValue.c_str()),
+              roundTrip(value).value.stringValue.c_str());
+}
+
+TEST(VisValueConverterTest, roundTripFloatsExactly) {
+    auto value = makeValue(VehiclePropertyType::FLOAT);
+    for (float f : {0.0f, -0.5f, 0.1f, 1.0f / 3, 16777217.0f, 3.4028235e38f, 1.17549435e-38f,
+                    std::nextafter(1.0f, 2.0f)}) {
+        value.value.floatValues = hidl_vec<float>{f};
+        EXPECT_EQ(f, roundTrip(value).value.floatValues[0]);
+    }
+}
+
+TEST(VisValueConverterTest, roundTripArrays) {
+    auto value = makeValue(VehiclePropertyType::INT32_VEC);
+    value.value.int32Values = hidl_vec<int32_t>{0, -1, std::numeric_limits<int32_t>::max()};
+    EXPECT_EQ(value.value.int32Values, roundTrip(value).value.int32Values);
+
+    value = makeValue(VehiclePropertyType::INT64_VEC);
+    value.value.int64Values = hidl_vec<int64_t>{std::numeric_limits<int64_t>::min(), 7};
+    EXPECT_EQ(value.value.int64Values, roundTrip(value).value.int64Values);
+
+    value = makeValue(VehiclePropertyType::FLOAT_VEC);
+    value.value.floatValues = hidl_vec<float>{1.5f, 0.3f, -1e-10f};
+    EXPECT_EQ(value.value.floatValues, roundTrip(value).value.floatValues);
+}
+
+TEST(VisValueConverterTest, convertReportsChange) {
+    JsonConverter convert = getJsonConverter(VehiclePropertyType::INT32);
+    VehiclePropValue::RawValue value = {};
+    bool changed = false;
+    ASSERT_TRUE(convert(Json::Value(5), &value, &changed));
+    EXPECT_TRUE(changed);
+    EXPECT_EQ(5, value.int32Values[0]);
+
+    changed = false;
+    ASSERT_TRUE(convert(Json::Value(5), &value, &changed));
+    EXPECT_FALSE(changed);
+}
+
+TEST(VisValueConverterTest, convertRejectsMismatchedType) {
+    VehiclePropValue::RawValue value = {};
+    value.int32Values = hidl_vec<int32_t>{3};
+    bool changed = false;
+    EXPECT_FALSE(getJsonConverter(VehiclePropertyType::INT32)(Json::Value("3"), &value, &changed));
+    EXPECT_FALSE(getJsonConverter(VehiclePropertyType::STRING)(Json::Value(3), &value, &changed));
+    EXPECT_FALSE(getJsonConverter(VehiclePropertyType::FLOAT)(Json::Value("x"), &value, &changed));
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(3, value.int32Values[0]);
+}
+
+TEST(VisValueConverterTest, convertArrayKeepsValueOnInvalidElement) {
+    JsonConverter convert = getJsonConverter(VehiclePropertyType::INT32_VEC);
+    VehiclePropValue::RawValue value = {};
+    value.int32Values = hidl_vec<int32_t>{1, 2};
+    bool changed = false;
+    EXPECT_FALSE(convert(parse("[5,\"x\"]"), &value, &changed));
+    EXPECT_FALSE(changed);
+    EXPECT_EQ(1, value.int32Values[0]);
+}
+
+TEST(VisValueConverterTest, convertArrayIgnoresTrailingElements) {
+    JsonConverter convert = getJsonConverter(VehiclePropertyType::INT64_VEC);
+    VehiclePropValue::RawValue value = {};
+    value.int64Values = hidl_vec<int64_t>{0, 0};
+    bool changed = false;
+    EXPECT_TRUE(convert(parse("[1,2,3]"), &value, &changed));
+    EXPECT_TRUE(changed);
+    ASSERT_EQ(2u, value.int64Values.size());
+    EXPECT_EQ(1, value.int64Values[0]);
+    EXPECT_EQ(2, value.int64Values[1]);
+}
+
+TEST(VisValueConverterTest, convertBooleanFromIntegers) {
+    JsonConverter convert = getJsonConverter(VehiclePropertyType::BOOLEAN);
+    VehiclePropValue::RawValue value = {};
+    bool changed = false;
+    EXPECT_TRUE(convert(Json::Value(true), &value, &changed));
+    EXPECT_EQ(1, value.int32Values[0]);
+    EXPECT_TRUE(convert(Json::Value(0), &value, &changed));
+    EXPECT_EQ(0, value.int32Values[0]);
+    EXPECT_TRUE(convert(Json::Value(Json::Int64(1) << 40), &value, &changed));
+    EXPECT_EQ(1, value.int32Values[0]);
+}
+
+TEST(VisValueConverterTest, noConverterForBytesAndMixed) {
+    EXPECT_EQ(nullptr, getJsonConverter(VehiclePropertyType::BYTES));
+    EXPECT_EQ(nullptr, getJsonConverter(VehiclePropertyType::MIXED));
+}
+
+}  // namespace
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
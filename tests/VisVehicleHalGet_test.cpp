@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/file.h>
+#include <cutils/properties.h>
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vhal_v2_0/VehicleObjectPool.h>
+#include <vhal_v2_0/VehiclePropertyStore.h>
+#include <vhal_v2_0/VehicleUtils.h>
+#include <vhal_v2_0/VisVehicleHal.h>
+
+#include "VisStandIn.h"
+#include "VisStandInServer.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+namespace {
+
+const char kGearPath[] = "Attribute.Vehicle.Drivetrain.Transmission.CurrentGear";
+
+/* CURRENT_GEAR is stored as GEAR_PARK until it is fetched from the stand-in. */
+const char kConfig[] = R"({
+    "Adapters": [
+        {"Plugin": "storageadapter.so", "Params": {"Data": {
+            "Attribute.Vehicle.Drivetrain.Transmission.CurrentGear": {"Value": 8}
+        }}}
+    ]
+})";
+
+/* A get answered from the store must not take longer even if VIS hangs. */
+constexpr auto kMaxGetLatency = std::chrono::milliseconds(50);
+
+class VisVehicleHalGetTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // VisClient connects to persist.vis.uri, which is not changed by the test, so the
+        // vehicle service is never left pointed to the stand-in.
+        char uri[PROPERTY_VALUE_MAX] = {};
+        property_get("persist.vis.uri", uri, "");
+        bool tls = false;
+        int port = VisStandInServer::getLoopbackPort(uri, &tls);
+        ASSERT_TRUE(port > 0 && !tls)
+            << "persist.vis.uri " << uri << " is not a ws:// loopback URI, set it first, "
+            << "e.g. setprop persist.vis.uri ws://127.0.0.1:18088";
+
+        TemporaryFile config;
+        ASSERT_TRUE(android::base::WriteStringToFile(kConfig, config.path));
+        ASSERT_TRUE(mVis.loadConfig(config.path));
+        ASSERT_TRUE(mServer.start(port));
+
+        // Values of the test must not replace the snapshot of the vehicle service.
+        mHal = std::make_unique<VisVehicleHal>(&mStore, "", true);
+        mHal->init(&mPool, [](VehicleHal::VehiclePropValuePtr) {},
+                   [](StatusCode, int32_t, int32_t) {},
+                   [](std::vector<VehicleHal::VehiclePropValuePtr>) {});
+    }
+
+    void TearDown() override {
+        // Pending VIS requests are answered, so the HAL threads can be stopped.
+        mServer.setStalled(false);
+        mHal.reset();
+        mServer.stop();
+    }
+
+    /* Returns the gear got from the HAL, measures the time the get takes. */
+    int32_t getGear(VehiclePropertyStatus* status, std::chrono::nanoseconds* latency) {
+        VehiclePropValue request = {.prop = toInt(VehicleProperty::CURRENT_GEAR)};
+        StatusCode code = StatusCode::OK;
+        auto start = std::chrono::steady_clock::now();
+        auto v = mHal->get(request, &code);
+        *latency = std::chrono::steady_clock::now() - start;
+        if (code != StatusCode::OK || v == nullptr || v->value.int32Values.size() != 1) {
+            ADD_FAILURE() << "Unable to get CURRENT_GEAR";
+            return -1;
+        }
+        *status = v->status;
+        return v->value.int32Values[0];
+    }
+
+    /* Polls the HAL until it returns gear as AVAILABLE, returns false on timeout. */
+    bool waitForGear(int32_t gear) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (std::chrono::steady_clock::now() < deadline) {
+            VehiclePropertyStatus status;
+            std::chrono::nanoseconds latency;
+            if (getGear(&status, &latency) == gear &&
+                status == VehiclePropertyStatus::AVAILABLE) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
+    VisStandIn mVis;
+    VisStandInServer mServer{&mVis};
+    VehiclePropertyStore mStore;
+    VehiclePropValuePool mPool;
+    std::unique_ptr<VisVehicleHal> mHal;
+};
+
+TEST_F(VisVehicleHalGetTest, getReturnsCachedValueWhileVisStalls) {
+    ASSERT_TRUE(waitForGear(toInt(VehicleGear::GEAR_DRIVE)));
+
+    mServer.setStalled(true);
+    mServer.publish(kGearPath, Json::Value(toInt(VehicleGear::GEAR_REVERSE)));
+
+    // Gets keep being answered from the store while the refresh they request is stuck, after
+    // kMaxUnsubscribedValueAge the value is marked as outdated.
+    std::chrono::nanoseconds worst(0);
+    VehiclePropertyStatus status = VehiclePropertyStatus::AVAILABLE;
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (std::chrono::steady_clock::now() < end) {
+        std::chrono::nanoseconds latency;
+        EXPECT_EQ(toInt(VehicleGear::GEAR_DRIVE), getGear(&status, &latency));
+        worst = std::max(worst, latency);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    RecordProperty("worst_get_latency_us",
+                   std::chrono::duration_cast<std::chrono::microseconds>(worst).count());
+    EXPECT_LT(worst, kMaxGetLatency);
+    if (!mVis.isSubscribed(kGearPath)) {
+        EXPECT_EQ(VehiclePropertyStatus::UNAVAILABLE, status);
+    }
+
+    // The refresh completes once VIS responds.
+    mServer.setStalled(false);
+    EXPECT_TRUE(waitForGear(toInt(VehicleGear::GEAR_REVERSE)));
+}
+
+}  // namespace
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
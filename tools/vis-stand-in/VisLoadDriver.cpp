@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "vis-load-driver"
+
+#include <cutils/properties.h>
+#include <getopt.h>
+#include <log/log.h>
+#include <utils/SystemClock.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vhal_v2_0/VehicleObjectPool.h>
+#include <vhal_v2_0/VehiclePropertyStore.h>
+#include <vhal_v2_0/VehicleUtils.h>
+#include <vhal_v2_0/VisVehicleHal.h>
+
+#include "VisStandIn.h"
+#include "VisStandInServer.h"
+
+using namespace android;
+using namespace android::hardware::automotive::vehicle::V2_0;
+using namespace android::hardware::automotive::vehicle::V2_0::xenvm;
+
+static void usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --config <file>    VIS server configuration to seed values from\n"
+            "                     (default cfg/visconfig.json)\n"
+            "  --path <path>      VIS path to push, mapped to an on-change INT32 property\n"
+            "                     (default Attribute.Vehicle.Drivetrain.Transmission.CurrentGear)\n"
+            "  --prop <id>        vehicle property the path is mapped to (default CURRENT_GEAR)\n"
+            "  --count <n>        number of updates to push (default 10000)\n"
+            "  --rate <n/s>       push rate, 0 pushes as fast as possible (default 1000)\n"
+            "  --cert <file>      TLS certificate, required if persist.vis.uri is wss://\n"
+            "  --key <file>       TLS key\n"
+            "The stand-in listens on the loopback port persist.vis.uri points to,\n"
+            "e.g. setprop persist.vis.uri ws://127.0.0.1:18088\n",
+            name);
+}
+
+static int64_t percentile(const std::vector<int64_t>& sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+int main(int argc, char* argv[]) {
+    const option options[] = {
+        {"config", required_argument, nullptr, 'c'}, {"path", required_argument, nullptr, 'a'},
+        {"prop", required_argument, nullptr, 'o'},   {"count", required_argument, nullptr, 'n'},
+        {"rate", required_argument, nullptr, 'r'},   {"cert", required_argument, nullptr, 't'},
+        {"key", required_argument, nullptr, 'k'},    {nullptr, 0, nullptr, 0},
+    };
+    std::string configPath = "cfg/visconfig.json";
+    std::string path = "Attribute.Vehicle.Drivetrain.Transmission.CurrentGear";
+    int32_t prop = toInt(VehicleProperty::CURRENT_GEAR);
+    int count = 10000;
+    double rate = 1000;
+    std::string certPath;
+    std::string keyPath;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, nullptr)) != -1) {
+        switch (opt) {
+            case 'c':
+                configPath = optarg;
+                break;
+            case 'a':
+                path = optarg;
+                break;
+            case 'o':
+                prop = static_cast<int32_t>(strtol(optarg, nullptr, 0));
+                break;
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 'r':
+                rate = atof(optarg);
+                break;
+            case 't':
+                certPath = optarg;
+                break;
+            case 'k':
+                keyPath = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (count <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // VisClient connects to persist.vis.uri, which is not changed, so a run never leaves the
+    // vehicle service pointed to the stand-in.
+    char uri[PROPERTY_VALUE_MAX] = {};
+    property_get("persist.vis.uri", uri, "");
+    bool tls = false;
+    int port = VisStandInServer::getLoopbackPort(uri, &tls);
+    if (port < 0 || tls != !certPath.empty()) {
+        fprintf(stderr, "persist.vis.uri %s is not a loopback URI the stand-in can serve\n", uri);
+        usage(argv[0]);
+        return 1;
+    }
+
+    VisStandIn vis;
+    if (!vis.loadConfig(configPath)) {
+        return 1;
+    }
+    VisStandInServer server(&vis);
+    if (!server.start(port, certPath, keyPath)) {
+        return 1;
+    }
+
+    // Pushed values are sequence numbers above any value of the configuration.
+    constexpr int32_t kFirstValue = 1000000;
+    std::unique_ptr<std::atomic<int64_t>[]> pushTimes(new std::atomic<int64_t>[count]);
+    std::vector<int64_t> latencies(count, -1);
+    std::mutex lock;
+    std::condition_variable cond;
+    int received = 0;
+    int64_t lastReceiveTime = 0;
+    auto onHalEvent = [&](VehicleHal::VehiclePropValuePtr v) {
+        int64_t now = elapsedRealtimeNano();
+        if (v->prop != prop || v->value.int32Values.size() != 1) {
+            return;
+        }
+        int32_t seq = v->value.int32Values[0] - kFirstValue;
+        if (seq < 0 || seq >= count) {
+            return;
+        }
+        std::lock_guard<std::mutex> g(lock);
+        if (latencies[seq] < 0) {
+            latencies[seq] = now - pushTimes[seq].load(std::memory_order_relaxed);
+            received++;
+            lastReceiveTime = now;
+            cond.notify_one();
+        }
+    };
+    auto onHalEvents = [&](std::vector<VehicleHal::VehiclePropValuePtr> values) {
+        for (auto& v : values) {
+            onHalEvent(std::move(v));
+        }
+    };
+    auto onSetError = [](StatusCode, int32_t, int32_t) {};
+
+    VehiclePropertyStore store;
+    VehiclePropValuePool pool;
+    // Values of the run must not replace the snapshot of the vehicle service.
+    auto hal = std::make_unique<VisVehicleHal>(&store, "");
+    hal->init(&pool, onHalEvent, onSetError, onHalEvents);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!vis.isSubscribed(path)) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            fprintf(stderr, "HAL has not subscribed to %s\n", path.c_str());
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // Let the initial fetch of all mapped paths complete.
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(rate > 0 ? 1 / rate : 0));
+    auto next = std::chrono::steady_clock::now();
+    int64_t firstPushTime = elapsedRealtimeNano();
+    for (int i = 0; i < count; i++) {
+        if (rate > 0) {
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+        pushTimes[i].store(elapsedRealtimeNano(), std::memory_order_relaxed);
+        server.publish(path, Json::Value(kFirstValue + i));
+    }
+    int64_t lastPushTime = elapsedRealtimeNano();
+    {
+        std::unique_lock<std::mutex> g(lock);
+        cond.wait_for(g, std::chrono::seconds(5), [&] { return received == count; });
+    }
+    hal.reset();
+    server.stop();
+
+    std::vector<int64_t> sorted;
+    for (int64_t latency : latencies) {
+        if (latency >= 0) {
+            sorted.push_back(latency);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end());
+    printf("pushed %d updates of %s in %.3f s, received %d events (%d lost)\n", count,
+           path.c_str(), (lastPushTime - firstPushTime) / 1e9, received, count - received);
+    if (sorted.empty()) {
+        return 1;
+    }
+    printf("throughput %.0f events/s\n",
+           received / ((lastReceiveTime - firstPushTime) / 1e9));
+    printf("latency us: min %.1f p50 %.1f p90 %.1f p99 %.1f max %.1f\n", sorted.front() / 1e3,
+           percentile(sorted, 0.5) / 1e3, percentile(sorted, 0.9) / 1e3,
+           percentile(sorted, 0.99) / 1e3, sorted.back() / 1e3);
+    return received == count ? 0 : 1;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "vis-stand-in"
+
+#include <log/log.h>
+
+#include <chrono>
+#include <fstream>
+
+#include "VisStandIn.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+static bool readJsonFile(const std::string& path, Json::Value* root) {
+    std::ifstream file(path);
+    if (!file) {
+        ALOGE("Unable to open %s", path.c_str());
+        return false;
+    }
+    Json::Reader reader;
+    if (!reader.parse(file, *root)) {
+        ALOGE("Unable to parse %s", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static std::string toString(const Json::Value& jval) {
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return Json::writeString(builder, jval);
+}
+
+static Json::Int64 getTimestamp() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+static Json::Value makeResponse(const Json::Value& request) {
+    Json::Value response;
+    response["action"] = request["action"];
+    if (request.isMember("requestId")) {
+        response["requestId"] = request["requestId"];
+    }
+    response["timestamp"] = getTimestamp();
+    return response;
+}
+
+static Json::Value makeError(const Json::Value& request, int number, const char* message) {
+    Json::Value response = makeResponse(request);
+    response["error"]["number"] = number;
+    response["error"]["message"] = message;
+    return response;
+}
+
+bool VisStandIn::loadConfig(const std::string& path) {
+    Json::Value root;
+    if (!readJsonFile(path, &root)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> g(mLock);
+    for (const Json::Value& adapter : root["Adapters"]) {
+        const Json::Value& data = adapter["Params"]["Data"];
+        for (auto it = data.begin(); it != data.end(); ++it) {
+            mValues[it.name()] = (*it)["Value"];
+        }
+    }
+    ALOGI("Loaded %zu VIS paths from %s", mValues.size(), path.c_str());
+    return true;
+}
+
+bool VisStandIn::loadSamples(const std::string& path, std::vector<Sample>* samples) {
+    Json::Value root;
+    if (!readJsonFile(path, &root)) {
+        return false;
+    }
+    Json::Reader reader;
+    for (const Json::Value& item : root) {
+        Sample sample = {item["key"].asString(), item["value"]};
+        // Sensor data keeps values as strings, e.g. "[0.1,0.4,0.0,3]".
+        Json::Value decoded;
+        if (sample.value.isString() && reader.parse(sample.value.asString(), decoded)) {
+            sample.value = decoded;
+        }
+        samples->push_back(std::move(sample));
+    }
+    return !samples->empty();
+}
+
+bool VisStandIn::matches(const std::string& pattern, const std::string& path) {
+    if (pattern == "*" || pattern == path) {
+        return true;
+    }
+    std::string prefix = pattern;
+    if (prefix.size() >= 2 && prefix.compare(prefix.size() - 2, 2, ".*") == 0) {
+        prefix.pop_back();
+    } else {
+        prefix += '.';
+    }
+    return path.compare(0, prefix.size(), prefix) == 0;
+}
+
+void VisStandIn::handleMessage(Client client, const std::string& text, std::vector<Message>* out) {
+    Json::Value request;
+    Json::Reader reader;
+    if (!reader.parse(text, request) || !request.isObject()) {
+        ALOGW("Ignoring malformed request: %s", text.c_str());
+        return;
+    }
+    std::string action = request["action"].asString();
+    Json::Value response;
+    if (action == "get") {
+        response = handleGet(request);
+    } else if (action == "set") {
+        response = handleSet(request, out);
+    } else if (action == "subscribe") {
+        response = handleSubscribe(client, request);
+    } else if (action == "unsubscribeAll") {
+        handleUnsubscribeAll(client);
+        response = makeResponse(request);
+    } else if (action == "authorize") {
+        response = makeResponse(request);
+    } else {
+        response = makeError(request, 400, "Unsupported action");
+    }
+    out->push_back({client, toString(response)});
+}
+
+Json::Value VisStandIn::handleGet(const Json::Value& request) {
+    std::string path = request["path"].asString();
+    Json::Value response = makeResponse(request);
+    Json::Value& value = response["value"];
+    value = Json::Value(Json::objectValue);
+    std::lock_guard<std::mutex> g(mLock);
+    for (const auto& it : mValues) {
+        if (matches(path, it.first)) {
+            value[it.first] = it.second;
+        }
+    }
+    if (value.empty()) {
+        return makeError(request, 404, "Path not found");
+    }
+    return response;
+}
+
+Json::Value VisStandIn::handleSet(const Json::Value& request, std::vector<Message>* out) {
+    std::string path = request["path"].asString();
+    Json::Value value = request["value"];
+    // VisClient sends values as strings, e.g. "[{\"Left.Temperature\":20}]".
+    Json::Value decoded;
+    if (value.isString() && Json::Reader().parse(value.asString(), decoded)) {
+        value = decoded;
+    }
+    // Values of a branch are sent as objects of paths relative to the branch.
+    std::map<std::string, Json::Value> values;
+    auto addRelative = [&values, &path](const Json::Value& object) {
+        for (auto it = object.begin(); it != object.end(); ++it) {
+            values[path + "." + it.name()] = *it;
+        }
+    };
+    if (value.isObject()) {
+        addRelative(value);
+    } else if (value.isArray() && !value.empty() && value[0].isObject()) {
+        for (const Json::Value& object : value) {
+            addRelative(object);
+        }
+    } else {
+        values[path] = value;
+    }
+
+    std::lock_guard<std::mutex> g(mLock);
+    for (const auto& it : values) {
+        if (mValues.count(it.first) == 0) {
+            return makeError(request, 404, "Path not found");
+        }
+    }
+    update(values, out);
+    return makeResponse(request);
+}
+
+Json::Value VisStandIn::handleSubscribe(Client client, const Json::Value& request) {
+    std::lock_guard<std::mutex> g(mLock);
+    uint64_t id = mNextSubscriptionId++;
+    mSubscriptions[id] = {client, request["path"].asString()};
+    Json::Value response = makeResponse(request);
+    response["subscriptionId"] = std::to_string(id);
+    return response;
+}
+
+void VisStandIn::handleUnsubscribeAll(Client client) {
+    removeClient(client);
+}
+
+void VisStandIn::publish(const std::string& path, const Json::Value& value,
+                         std::vector<Message>* out) {
+    std::lock_guard<std::mutex> g(mLock);
+    update({{path, value}}, out);
+}
+
+void VisStandIn::update(const std::map<std::string, Json::Value>& values,
+                        std::vector<Message>* out) {
+    for (const auto& it : values) {
+        mValues[it.first] = it.second;
+    }
+    for (const auto& it : mSubscriptions) {
+        Json::Value notification;
+        for (const auto& value : values) {
+            if (matches(it.second.path, value.first)) {
+                notification["value"][value.first] = value.second;
+            }
+        }
+        if (notification.isNull()) {
+            continue;
+        }
+        notification["action"] = "subscription";
+        notification["subscriptionId"] = std::to_string(it.first);
+        notification["timestamp"] = getTimestamp();
+        out->push_back({it.second.client, toString(notification)});
+    }
+}
+
+void VisStandIn::removeClient(Client client) {
+    std::lock_guard<std::mutex> g(mLock);
+    for (auto it = mSubscriptions.begin(); it != mSubscriptions.end();) {
+        it = it->second.client == client ? mSubscriptions.erase(it) : std::next(it);
+    }
+}
+
+bool VisStandIn::isSubscribed(const std::string& path) const {
+    std::lock_guard<std::mutex> g(mLock);
+    for (const auto& it : mSubscriptions) {
+        if (matches(it.second.path, path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Json::Value VisStandIn::getValue(const std::string& path) const {
+    std::lock_guard<std::mutex> g(mLock);
+    auto it = mValues.find(path);
+    return it != mValues.end() ? it->second : Json::Value();
+}
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
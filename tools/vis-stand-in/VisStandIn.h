@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TOOLS_VIS_STAND_IN_VISSTANDIN_H_
+#define TOOLS_VIS_STAND_IN_VISSTANDIN_H_
+
+#include <json/json.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+/*
+ * VIS protocol state of the local VIS stand-in server, independent of the transport.
+ *
+ * Implements the subset of the VIS protocol used by VisClient: get, set, subscribe and
+ * unsubscribeAll. Values are given as an object of VIS path to value, as sent by the DomD VIS
+ * server. A path matches itself, its children if it is a branch, and "*" matches every path.
+ * Clients are opaque handles of the transport connections.
+ *
+ * This class is thread-safe.
+ */
+class VisStandIn {
+public:
+    using Client = const void*;
+
+    struct Message {
+        Client client;
+        std::string text;
+    };
+
+    struct Sample {
+        std::string path;
+        Json::Value value;
+    };
+
+    /* Seeds values from storage adapter data of the VIS server configuration, e.g.
+     * cfg/visconfig.json. Returns false if the file can't be parsed. */
+    bool loadConfig(const std::string& path);
+
+    /* Reads samples to replay, e.g. cfg/visdata.json. String values holding JSON are decoded. */
+    static bool loadSamples(const std::string& path, std::vector<Sample>* samples);
+
+    /* Handles a request of the client, adds the response and notifications to out. */
+    void handleMessage(Client client, const std::string& text, std::vector<Message>* out);
+
+    /* Updates the value as if it came from the vehicle, adds notifications to out. */
+    void publish(const std::string& path, const Json::Value& value, std::vector<Message>* out);
+
+    /* Drops subscriptions of the disconnected client. */
+    void removeClient(Client client);
+
+    /* Returns true if any client is subscribed to the path. */
+    bool isSubscribed(const std::string& path) const;
+
+    Json::Value getValue(const std::string& path) const;
+
+private:
+    struct Subscription {
+        Client client;
+        std::string path;
+    };
+
+    static bool matches(const std::string& pattern, const std::string& path);
+
+    Json::Value handleGet(const Json::Value& request);
+    Json::Value handleSet(const Json::Value& request, std::vector<Message>* out);
+    Json::Value handleSubscribe(Client client, const Json::Value& request);
+    void handleUnsubscribeAll(Client client);
+
+    /* Stores the values and notifies subscribers, called under mLock. */
+    void update(const std::map<std::string, Json::Value>& values, std::vector<Message>* out);
+
+    mutable std::mutex mLock;
+    std::map<std::string, Json::Value> mValues;
+    /* Subscription id to subscription. */
+    std::map<uint64_t, Subscription> mSubscriptions;
+    uint64_t mNextSubscriptionId = 1;
+};
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif /* TOOLS_VIS_STAND_IN_VISSTANDIN_H_ */
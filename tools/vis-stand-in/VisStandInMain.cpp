@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "vis-stand-in"
+
+#include <getopt.h>
+#include <log/log.h>
+#include <signal.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "VisStandIn.h"
+#include "VisStandInServer.h"
+
+using namespace android::hardware::automotive::vehicle::V2_0::xenvm;
+
+static std::atomic<bool> gStop(false);
+
+static void usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --port <port>      port to listen on at 127.0.0.1 (default 8088)\n"
+            "  --config <file>    VIS server configuration to seed values from\n"
+            "                     (default cfg/visconfig.json)\n"
+            "  --data <file>      samples to replay (default cfg/visdata.json)\n"
+            "  --rate <samples/s> replay rate, 0 disables replay (default 10)\n"
+            "  --cert <file>      TLS certificate, plain WebSocket is used without it\n"
+            "  --key <file>       TLS key\n",
+            name);
+}
+
+int main(int argc, char* argv[]) {
+    const option options[] = {
+        {"port", required_argument, nullptr, 'p'}, {"config", required_argument, nullptr, 'c'},
+        {"data", required_argument, nullptr, 'd'}, {"rate", required_argument, nullptr, 'r'},
+        {"cert", required_argument, nullptr, 't'}, {"key", required_argument, nullptr, 'k'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int port = 8088;
+    std::string configPath = "cfg/visconfig.json";
+    std::string dataPath = "cfg/visdata.json";
+    double rate = 10;
+    std::string certPath;
+    std::string keyPath;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", options, nullptr)) != -1) {
+        switch (opt) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'c':
+                configPath = optarg;
+                break;
+            case 'd':
+                dataPath = optarg;
+                break;
+            case 'r':
+                rate = atof(optarg);
+                break;
+            case 't':
+                certPath = optarg;
+                break;
+            case 'k':
+                keyPath = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    VisStandIn vis;
+    if (!vis.loadConfig(configPath)) {
+        return 1;
+    }
+    std::vector<VisStandIn::Sample> samples;
+    if (rate > 0 && !VisStandIn::loadSamples(dataPath, &samples)) {
+        return 1;
+    }
+    VisStandInServer server(&vis);
+    if (!server.start(port, certPath, keyPath)) {
+        return 1;
+    }
+    signal(SIGINT, [](int) { gStop = true; });
+    signal(SIGTERM, [](int) { gStop = true; });
+
+    // Samples are replayed in a loop at a fixed rate, the recorded timestamps are ignored.
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(rate > 0 ? 1 / rate : 1));
+    auto next = std::chrono::steady_clock::now();
+    for (size_t i = 0; !gStop; i++) {
+        next += period;
+        std::this_thread::sleep_until(next);
+        if (!samples.empty()) {
+            const auto& sample = samples[i % samples.size()];
+            server.publish(sample.path, sample.value);
+        }
+    }
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "vis-stand-in"
+
+#include <log/log.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "VisStandInServer.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+bool VisStandInServer::start(uint16_t port, const std::string& certPath,
+                             const std::string& keyPath) {
+    std::promise<bool> listening;
+    auto result = listening.get_future();
+    mThread = std::thread(&VisStandInServer::loop, this, port, certPath, keyPath, &listening);
+    if (!result.get()) {
+        mThread.join();
+        return false;
+    }
+    return true;
+}
+
+void VisStandInServer::stop() {
+    {
+        std::lock_guard<std::mutex> g(mLock);
+        if (mAsync == nullptr) {
+            return;
+        }
+        mStopping = true;
+        mAsync->send();
+    }
+    mThread.join();
+}
+
+void VisStandInServer::publish(const std::string& path, const Json::Value& value) {
+    std::vector<VisStandIn::Message> messages;
+    mVis->publish(path, value, &messages);
+    if (messages.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> g(mLock);
+    if (mAsync == nullptr) {
+        return;
+    }
+    mPending.insert(mPending.end(), messages.begin(), messages.end());
+    mAsync->send();
+}
+
+void VisStandInServer::setStalled(bool stalled) {
+    std::lock_guard<std::mutex> g(mLock);
+    mStalled = stalled;
+    if (!stalled && mAsync != nullptr) {
+        // Flushes the messages held back meanwhile.
+        mAsync->send();
+    }
+}
+
+int VisStandInServer::getLoopbackPort(const std::string& uri, bool* tls) {
+    std::string rest;
+    if (uri.compare(0, 6, "wss://") == 0) {
+        *tls = true;
+        rest = uri.substr(6);
+    } else if (uri.compare(0, 5, "ws://") == 0) {
+        *tls = false;
+        rest = uri.substr(5);
+    } else {
+        return -1;
+    }
+    size_t colon = rest.find(':');
+    std::string host = rest.substr(0, colon);
+    if ((host != "127.0.0.1" && host != "localhost") || colon == std::string::npos) {
+        return -1;
+    }
+    char* end;
+    long port = strtol(rest.c_str() + colon + 1, &end, 10);
+    if (port <= 0 || port > 65535 || (*end != '\0' && *end != '/')) {
+        return -1;
+    }
+    return static_cast<int>(port);
+}
+
+void VisStandInServer::onAsync(uS::Async* async) {
+    auto server = static_cast<VisStandInServer*>(async->getData());
+    std::vector<VisStandIn::Message> messages;
+    bool stopping;
+    {
+        std::lock_guard<std::mutex> g(server->mLock);
+        stopping = server->mStopping;
+        if (!server->mStalled || stopping) {
+            messages.swap(server->mPending);
+        }
+        if (stopping) {
+            server->mAsync = nullptr;
+        }
+    }
+    server->send(messages);
+    if (stopping) {
+        // The loop exits once the sockets and the async handle are closed.
+        server->mHub->getDefaultGroup<uWS::SERVER>().close();
+        async->close();
+    }
+}
+
+void VisStandInServer::loop(uint16_t port, const std::string& certPath,
+                            const std::string& keyPath, std::promise<bool>* listening) {
+    uWS::Hub hub;
+    hub.onConnection([this](uWS::WebSocket<uWS::SERVER>* ws, uWS::HttpRequest) {
+        ALOGI("VIS client connected");
+        mClients.insert(ws);
+    });
+    hub.onDisconnection([this](uWS::WebSocket<uWS::SERVER>* ws, int, char*, size_t) {
+        ALOGI("VIS client disconnected");
+        mClients.erase(ws);
+        mVis->removeClient(ws);
+        std::lock_guard<std::mutex> g(mLock);
+        mPending.erase(std::remove_if(mPending.begin(), mPending.end(),
+                                      [ws](const VisStandIn::Message& m) {
+                                          return m.client == ws;
+                                      }),
+                       mPending.end());
+    });
+    hub.onMessage(
+        [this](uWS::WebSocket<uWS::SERVER>* ws, char* message, size_t length, uWS::OpCode) {
+            std::vector<VisStandIn::Message> messages;
+            mVis->handleMessage(ws, std::string(message, length), &messages);
+            {
+                std::lock_guard<std::mutex> g(mLock);
+                if (mStalled) {
+                    mPending.insert(mPending.end(), messages.begin(), messages.end());
+                    return;
+                }
+            }
+            send(messages);
+        });
+
+    uS::TLS::Context tls = nullptr;
+    if (!certPath.empty() && !keyPath.empty()) {
+        tls = uS::TLS::createContext(certPath, keyPath);
+    }
+    if (!hub.listen("127.0.0.1", port, tls)) {
+        ALOGE("Unable to listen on port %u", port);
+        listening->set_value(false);
+        return;
+    }
+    ALOGI("Listening on port %u", port);
+    mHub = &hub;
+    {
+        std::lock_guard<std::mutex> g(mLock);
+        mAsync = new uS::Async(hub.getLoop());
+        mAsync->setData(this);
+        mAsync->start(&VisStandInServer::onAsync);
+    }
+    listening->set_value(true);
+    hub.run();
+    mHub = nullptr;
+    mClients.clear();
+}
+
+void VisStandInServer::send(const std::vector<VisStandIn::Message>& messages) {
+    for (const auto& message : messages) {
+        if (mClients.count(message.client) == 0) {
+            continue;
+        }
+        auto ws = static_cast<uWS::WebSocket<uWS::SERVER>*>(const_cast<void*>(message.client));
+        ws->send(message.text.data(), message.text.size(), uWS::OpCode::TEXT);
+    }
+}
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
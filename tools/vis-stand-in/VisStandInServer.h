@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2019 EPAM Systems Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TOOLS_VIS_STAND_IN_VISSTANDINSERVER_H_
+#define TOOLS_VIS_STAND_IN_VISSTANDINSERVER_H_
+
+#include <uWS.h>
+
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "VisStandIn.h"
+
+namespace android {
+namespace hardware {
+namespace automotive {
+namespace vehicle {
+namespace V2_0 {
+namespace xenvm {
+
+/*
+ * WebSocket transport of VisStandIn, runs the event loop in its own thread.
+ *
+ * Values may be published from any thread, the notifications are handed over to the event loop
+ * thread and sent from it.
+ */
+class VisStandInServer {
+public:
+    explicit VisStandInServer(VisStandIn* vis) : mVis(vis) {}
+    ~VisStandInServer() { stop(); }
+
+    VisStandInServer(const VisStandInServer&) = delete;
+    VisStandInServer& operator=(const VisStandInServer&) = delete;
+
+    /* Listens on the loopback interface, uses TLS if certificate and key are given. Returns
+     * false if the port can't be listened on. */
+    bool start(uint16_t port, const std::string& certPath = "", const std::string& keyPath = "");
+    void stop();
+
+    void publish(const std::string& path, const Json::Value& value);
+    /* While stalled responses and notifications are held back as if VIS hung, they are sent
+     * once the server is resumed. */
+    void setStalled(bool stalled);
+
+    /* Returns the port of the loopback VIS URI, e.g. ws://127.0.0.1:18088, or -1 if the URI
+     * points elsewhere. tls is set if the URI requires TLS. */
+    static int getLoopbackPort(const std::string& uri, bool* tls);
+
+private:
+    static void onAsync(uS::Async* async);
+
+    void loop(uint16_t port, const std::string& certPath, const std::string& keyPath,
+              std::promise<bool>* listening);
+    /* Sends messages to the clients which are still connected, called on the loop thread. */
+    void send(const std::vector<VisStandIn::Message>& messages);
+
+    VisStandIn* mVis;
+    std::thread mThread;
+    uWS::Hub* mHub = nullptr;
+    uS::Async* mAsync = nullptr;
+    /* Connected clients, accessed only on the loop thread. */
+    std::unordered_set<VisStandIn::Client> mClients;
+
+    std::mutex mLock;
+    std::vector<VisStandIn::Message> mPending;
+    bool mStalled = false;
+    bool mStopping = false;
+};
+
+}  // namespace xenvm
+}  // namespace V2_0
+}  // namespace vehicle
+}  // namespace automotive
+}  // namespace hardware
+}  // namespace android
+
+#endif /* TOOLS_VIS_STAND_IN_VISSTANDINSERVER_H_ */